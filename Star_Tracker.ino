@@ -19,10 +19,18 @@ MountController mount(MotorController::instance());
 
 Control control(mount, camera, persistent_clock);
 
+#ifdef VIRTUAL_CLOCK_RATE
+  VirtualTime virtual_time;
+#endif
+
 void setup() {
 
   Serial.begin(SERIAL_BAUD_RATE);
   delay(10);
+  #ifdef VIRTUAL_CLOCK_RATE
+    virtual_time.set_rate(VIRTUAL_CLOCK_RATE);
+    Clock::set_time_source(virtual_time);
+  #endif
   control.initialize();
   delay(100);
 
@@ -31,6 +39,7 @@ void setup() {
 void loop() {
 
   control.update();
+  Log::drain(Serial);
   delay(10);
 
 }
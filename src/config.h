@@ -4,7 +4,7 @@
 /* ================================== GENERAL SETTINGS ================================== */
 
 #define SERIAL_BAUD_RATE       115200
-#define EEPROM_ADDR            0            // starting EEPROM offset, 18 bytes needed 
+#define EEPROM_ADDR            0            // starting EEPROM offset, 407 bytes needed 
 #define VERSION                1.0
 
 #define LONGITUDE              16.2607719   // CHANGE THIS !!!!!
@@ -25,6 +25,63 @@
 #define DEFAULT_POLE_DEC        90   // these values are changed during alignment
 #define DEFUALT_RA_OFFSET       0    // offset of RA axis (defines where mount's local RA is 0)
 
+#define POLE_TOLERANCE          0.0001  // poles closer (deg) to {90, ..} or {LATITUDE, 180} than this
+                                        // use faster transforms for equatorial or alt-az mounts,
+                                        // set to -1 to always use the general rotation
+
+// #define FAST_TRIG                    // use fixed point table & CORDIC trigonometry (core/trig.h)
+                                        // instead of the float one for coordinate conversions
+
+#define MOUNT_REAL              float   // scalar of coordinate conversions, float, double (which is
+                                        // float on AVR) or fixed_t (Q2.29, see core/coords.h)
+
+
+#define GOTO_TIME_TOLERANCE_MS  1       // slew duration is iterated until it changes less than this
+#define GOTO_MAX_ITERATIONS     6       // maximal number of slew planning iterations
+
+// Limits of mount axes in the local coordinates of the mount (degrees), slews choose the
+// fastest of equivalent positions (RA +- 360, or going over the pole of the mount which is
+// possible if DEC limits exceed -90..90) that fits them, so widen them if cables allow it
+// (the native build overrides them to compare GOTO durations, see tools/goto_sim.cpp)
+
+#ifndef RA_LIMIT_MIN
+#define RA_LIMIT_MIN            0       // RA must not go below this (e.g. -90 for 90 deg of wrap)
+#define RA_LIMIT_MAX            360     // RA must not go above this (e.g. 450)
+#define DEC_LIMIT_MIN           -90     // DEC must not go below this (up to -180)
+#define DEC_LIMIT_MAX           90      // DEC must not go above this (up to 180)
+#endif
+
+// Slews and jogs are refused if they would point the mount into a forbidden direction. The map 
+// of these directions in local coordinates of the mount is loaded from KEEP_OUT_FILE on the SD 
+// card (and stored to EEPROM) during startup. The file has 180 / KEEP_OUT_CELL_DEG lines from 
+// local DEC 90 down to -90 and each of them has 360 / KEEP_OUT_CELL_DEG characters from local 
+// RA 0 to 360, 'X' means forbidden cell, anything else is allowed, lines starting with '#' are 
+// comments. Remove the file and reboot after you change it to keep the stored map. 
+
+#define KEEP_OUT_CELL_DEG       5               // size of keep-out cells (divisor of 90)
+#define KEEP_OUT_FILE           "/keepout.txt"  // keep-out map on the SD card
+
+#define SIDEREAL_DEG_PER_MS     (360.0f / 86164090.5f) // rotation of the sky (deg per ms)
+#define APPARENT_REFRESH_S      300     // J2000 -> apparent place matrix is recomputed after this
+
+#define REFRACTION_TEMPERATURE  10      // usual night temperature (deg C) for atmospheric refraction
+#define REFRACTION_PRESSURE     1010    // usual atmospheric pressure (mbar), 0 disables refraction
+
+// Tracking can either follow a schedule of speeds computed in advance, each of them anchored
+// to the position of the object at the start of its movement (TRACKING_RATES), or it can
+// repeatedly compute the exact position of the object at the end of a short movement and
+// correct the position of motors (TRACKING_POSITIONS), neither of them accumulates errors,
+// TRACKING_MODE is the default mode (see MountController::set_tracking_mode)
+
+#define TRACKING_RATES          0
+#define TRACKING_POSITIONS      1
+#define TRACKING_MODE           TRACKING_POSITIONS
+
+#define TRACKING_SEGMENT_MS     60000   // duration of a single tracking movement with constant speed
+#define TRACKING_SEGMENTS_AHEAD 4       // number of tracking movements queued in advance (max. 7)
+#define TRACKING_CORRECTION_MS  1000    // duration of a single movement of position tracking
+#define TRACKING_MAX_RATE       0.05f   // maximal speed (deg/s) of position tracking corrections
+
 
 // Alignement is done by optimization of rotation matrix parameters (three), this is done 
 // by a simple evolutionary strategy. Exact numeric solutions can be unstable due to Arduino
@@ -69,6 +126,13 @@
 #define FAST_REVS_PER_SEC_DEC   1000000.0 / FAST_DELAY_START_DEC / STEPS_PER_REV_DEC 
 #define FAST_REVS_PER_SEC_RA    1000000.0 / FAST_DELAY_START_RA  / STEPS_PER_REV_RA
 
+// Durations of fast movements are measured and the theoretical duration is corrected by a 
+// learned model (saved in EEPROM), so GoTo can compensate the sky motion precisely 
+
+#define SLEW_MODEL_KNOTS          8     // knots of the piecewise linear model (16 * 4^i steps)
+#define SLEW_MODEL_MIN_STEPS      64    // shorter movements are not used for learning
+#define SLEW_MODEL_LEARNING_RATE  0.25  // how fast is the model adapted to new measurements
+
 
 /* ==================================== OTHER SETTINGS ================================== */
 
@@ -77,8 +141,11 @@
 
 #define SD_CS                   53      // SD card chip select pin
 
+#define STATS_REQUEST_CHAR      '?'     // serial input which prints (and resets) the runtime stats
+
 #define KEYPAD_IR_PIN           7       // IR receiver signal pin 
-#define SHORT_HOLD_TIME_MS      200     // minimal duration (ms) of a fast remote control key press
+#define KEYPAD_IR_PINS          PINH    // input register and bit of the IR receiver pin (7 = PH4,
+#define KEYPAD_IR_BIT           PH4     // search for A. Mega pinout)
 #define LONG_HOLD_TIME_MS       800     // minimal duration (ms) of a slow remote control key press
 
 #define DSP_DATA_PIN4           2       // LCD data pins
@@ -91,10 +158,16 @@
 
 /* ======================================== DEBUG ======================================= */
 
+// debug messages are records of the binary log, which is sent over serial from loop() and
+// decoded by tools/log_decode.cpp (see core/log.h)
+#define LOG_BUFFER_SIZE         128     // bytes of each of the two rings of the log (32, 64 or 128)
+
 // #define DEBUG
 // #define DEBUG_MOUNT
 // #define DEBUG_TIME
 // #define DEBUG_CONTROL
 // #define DEBUG_KEYS
 
+// #define VIRTUAL_CLOCK_RATE   60   // the clock runs 60 times faster (for testing without motors)
+
 #endif
\ No newline at end of file
@@ -9,12 +9,27 @@ void Control::initialize() {
     load(_brightness_buffer, EEPROM_ADDR + 4, 0, 255, 128);
 
     _mount.initialize();
+    
+    MotorController::slew_model_t slew_model;
+    load(slew_model, EEPROM_ADDR + 18);
+    _mount.set_slew_model(slew_model);
+
     _display.initialize(_brightness_buffer);
 
-    SD.begin(SD_CS);
-    _sd = &SD;
+    hal::storage_begin();
 
-    _keypad.initialize();
+    // the file on SD card has priority, the map in EEPROM is valid just with the magic byte
+    KeepOutMap& keep_out = _mount.get_keep_out();
+    if (import_keep_out()) {
+        for (int i = 0; i < KEEP_OUT_BYTES; i++) hal::eeprom_update(EEPROM_ADDR + 83 + i, keep_out.data()[i]);
+        hal::eeprom_update(EEPROM_ADDR + 82, KEEP_OUT_MAGIC);
+    }
+    else if (hal::eeprom_read(EEPROM_ADDR + 82) == KEEP_OUT_MAGIC) {
+        for (int i = 0; i < KEEP_OUT_BYTES; i++) keep_out.data()[i] = hal::eeprom_read(EEPROM_ADDR + 83 + i);
+    }
+
+    static const uint32_t hold_keys[] = C_HOLD_KEYS;
+    _keypad.initialize(hold_keys, sizeof(hold_keys) / sizeof(hold_keys[0]));
     _camera.initialize();
 
     _clock.obtain_time();
@@ -27,9 +42,20 @@ void Control::initialize() {
 
 void Control::update() {
 
+    RuntimeStats::record_loop();
+
+    if (Serial.available() && Serial.read() == STATS_REQUEST_CHAR) {
+        RuntimeStats::print(Serial);
+        RuntimeStats::reset();
+    }
+
+    Clock::update();
     _keypad.update();
     _camera.update();
 
+    _mount.update();
+    if (_mount.learn_slew_duration()) save(_mount.get_slew_model(), EEPROM_ADDR + 18);
+
     _last_state_changed = _state_changed;
     _last_substate_changed = _substate_changed;
     _state_changed = false;
@@ -37,6 +63,9 @@ void Control::update() {
 
     if (_keypad.pressed(C_EXIT)) change_state(HELP);
 
+    State state = _state;
+    unsigned long start_us = micros();
+
     switch (_state) {
         case MAIN: 	  main_menu(); break;
         case HELP: 	  help_menu(); break;
@@ -47,17 +76,20 @@ void Control::update() {
         case TIME:    time_menu(); break;
         case BRIGHT:    brightness_menu(); break;
         case POSITION:  position_menu(); break;
+        case UNSAFE:    unsafe_menu(); break;
     }
+
+    RuntimeStats::record_state(state, start_us);
 }
 
 void Control::help_menu() {
 
-    if (_last_state_changed) _last_substate_change_time = millis();
+    if (_last_state_changed) _last_substate_change_time = Clock::millis();
 
     if (_keypad.pushed(C_EXIT)) change_state(MAIN);
 
-    if ((millis() - _last_substate_change_time) > INFO_SCREEN_MS) {
-        _last_substate_change_time = millis();
+    if ((Clock::millis() - _last_substate_change_time) > INFO_SCREEN_MS) {
+        _last_substate_change_time = Clock::millis();
         change_substate(increment_substate());
         if (_substate > S9) change_substate(S0);
     }
@@ -65,6 +97,16 @@ void Control::help_menu() {
     _display.render_help(_last_state_changed || _last_substate_changed, _substate);			
 }
 
+void Control::unsafe_menu() {
+
+    _display.render_unsafe(_last_state_changed);
+
+    if ((Clock::millis() - _last_substate_change_time) > INFO_SCREEN_MS) {
+        _state = _info_return_state;
+        change_substate(_info_return_substate);
+    }
+}
+
 void Control::position_menu() {
 
     if (_keypad.pushed(C_EXIT)) change_state(MAIN);
@@ -161,10 +203,7 @@ void Control::goto_menu() {
     if (_substate == S5 && _keypad.pushed(C_ENTER)) {
 
         change_state(MAIN);
-        auto coords = position_buffers_to_coords();
-        _mount.stop_all();
-        _camera.reset();
-        _mount.move_absolute(coords.dec, coords.ra);
+        go_to(position_buffers_to_coords(), false);
 
         return;
     }
@@ -304,7 +343,7 @@ void Control::calibration_menu() {
         if (_keypad.pushed(C_EXIT)) change_state(MAIN);
         else if (_keypad.pushed(C_N1)) {
             change_substate(S1);
-            _last_substate_change_time = millis();
+            _last_substate_change_time = Clock::millis();
         }
         else if (_keypad.pushed(C_N2) && _calibration_buffer_size >= 3) {
             
@@ -327,7 +366,7 @@ void Control::calibration_menu() {
     if (_substate == S1) {
         if (_keypad.pushed(C_EXIT)) change_substate(S0);
         _display.render_calibration_info(_last_substate_changed);
-        if (millis() - _last_substate_change_time > INFO_SCREEN_MS) change_substate(S2);
+        if (Clock::millis() - _last_substate_change_time > INFO_SCREEN_MS) change_substate(S2);
         return;
     }
 
@@ -359,14 +398,13 @@ void Control::calibration_menu() {
                 
     if (_substate == S7 && _keypad.pushed(C_ENTER)) {
 
+        change_substate(S8);
+
         if (_calibration_buffer_size < CAL_BUFFER_SIZE) {
             _kernel = position_buffers_to_coords();							
-            _mount.stop_all();
-            _camera.reset();
-            _mount.move_absolute(_kernel.dec, _kernel.ra);
+            go_to(_kernel, false);
         }
 
-        change_substate(S8);
         return;
     }
 
@@ -397,9 +435,7 @@ void Control::catalogue_menu() {
         if (_keypad.pushed(C_EXIT)) change_state(MAIN);
         if (_keypad.pushed(C_ENTER)) {
             change_state(MAIN);
-            _mount.stop_all();
-            _camera.reset();
-            _mount.move_absolute_J2000(_kernel.dec, _kernel.ra);
+            go_to(_kernel, true);
         }
         return;
     }
@@ -457,6 +493,59 @@ void Control::manual_control(ControlSubState nothing, ControlSubState degrees, C
     else if (_keypad.pushed(C_ARROW_DOWN))   _mount.move_relative_local(-1 / conversion_ratio, 0);
 }
 
+void Control::go_to(MountController::coord_t target, bool j2000) {
+
+    _mount.stop_all();
+    _camera.reset();
+
+    bool moving = j2000 ? _mount.move_absolute_J2000(target.dec, target.ra) 
+                        : _mount.move_absolute(target.dec, target.ra);
+    if (moving) return;
+
+    _info_return_state = _state;
+    _info_return_substate = _substate;
+    change_state(UNSAFE);
+}
+
+bool Control::import_keep_out() {
+
+    hal::File file = hal::storage_open(KEEP_OUT_FILE);
+    if (!file) return false;
+
+    KeepOutMap& keep_out = _mount.get_keep_out();
+    keep_out.clear();
+
+    // the first line is the top (DEC 90) of the map, rows are indexed from DEC -90
+    int row = 0;
+    int col = 0;
+    bool skip_line = false;
+
+    int next;
+    while ((next = file.read()) != -1 && row < KEEP_OUT_ROWS) {
+        char c = (char)next;
+
+        if (c == '\r') continue;
+        if (c == '\n') {
+            if (!skip_line) row++;
+            skip_line = false;
+            col = 0;
+            continue;
+        }
+        if (col == 0 && c == '#') skip_line = true;
+        if (skip_line || col >= KEEP_OUT_COLS) continue;
+
+        keep_out.set_cell_blocked(KEEP_OUT_ROWS - 1 - row, col++, c == 'X');
+    }
+
+    file.close();
+
+    #ifdef DEBUG_CONTROL
+        LOG(KEEP_OUT_ROWS, row);
+    #endif
+
+    return true;
+}
+
 int Control::get_pushed_digit() {
 
          if (_keypad.pushed(C_N1)) { return 1; }
@@ -477,27 +566,22 @@ int Control::get_pushed_digit() {
 bool Control::find_in_catalogue(ControlSubState catalogue, int object, MountController::coord_t& coords, 
                                 float& magnitude, float& size_a, float& size_b, char type[6]) {
     #ifdef DEBUG_CONTROL
-        Serial.println(F("=============="));
-        File root = SD.open("/");
+        hal::File root = hal::storage_open("/");
         while (true) {
-            File entry =  root.openNextFile();
+            hal::File entry =  root.openNextFile();
             if (!entry) break;
-            Serial.print('\t');
-            Serial.print(entry.name());
-            Serial.print("\t\t");
-            Serial.println(entry.size(), DEC);
+            LOG(SD_FILE, entry.name(), entry.size());
             entry.close();
         }
-        Serial.println(F("===================="));
     #endif
 
     const char* path = "/catalog.csv";
 
-    File file = _sd->open(path);
+    hal::File file = hal::storage_open(path);
             
     if (!file) {
         #ifdef DEBUG_CONTROL
-            Serial.println("Catalogue file not found!");
+            LOG(CATALOGUE_MISSING);
         #endif
         return false;
     }
@@ -562,11 +646,7 @@ bool Control::find_in_catalogue(ControlSubState catalogue, int object, MountCont
     }
 
     #ifdef DEBUG_CONTROL
-        if (!row_found) {
-            Serial.print(F("Object "));
-            Serial.print(object);
-            Serial.println(" not found in the catalogue!");
-        }
+        if (!row_found) LOG(OBJECT_MISSING, object);
     #endif	 
 
     file.close();
@@ -1,16 +1,12 @@
 #ifndef CONTROL_H
 #define CONTROL_H
 
-#include <Arduino.h>
-#include <EEPROM.h>
-#include <SPI.h>
-#include <SD.h>
-#include <RTClib.h>
-
 #include "../config.h"
+#include "../hal/hal.h"
 #include "../core/mount_controller.h"
 #include "../core/camera_controller.h"
 #include "../core/clock.h"
+#include "../core/runtime_stats.h"
 
 #include "keypad.h"
 #include "display.h"
@@ -48,10 +44,15 @@
 #define C_N9					KP_KEY_9
 #define C_N0					KP_KEY_0
 
+// keys which are also taken as pressed (held), their push is known at the release, other keys
+// are pushed as soon as their frame comes
+#define C_HOLD_KEYS             { C_ARROW_UP, C_ARROW_LEFT, C_ARROW_RIGHT, C_ARROW_DOWN, C_EXIT, C_TRACKING, C_CALIBRATION, C_N0 }
+
 //	=================================
 //	=================================
 
 #define INFO_SCREEN_MS       1500 	// how long will be an intermediate (informative) screen displayed
+#define KEEP_OUT_MAGIC       0x4B   // marks a valid keep-out map in EEPROM
 
 enum ControlSubState : short { S0 = 0, S1, S2, S3, S4, S5, S6, S7, S8, S9, S10, S11 };
 
@@ -59,7 +60,7 @@ class Control {
 
       public:
 
-        enum State { MAIN, HELP, GOTO, CALIB, CATALOG, SHOOT, TIME, POSITION, BRIGHT };
+        enum State { MAIN, HELP, GOTO, CALIB, CATALOG, SHOOT, TIME, POSITION, BRIGHT, UNSAFE };
 
         Control(MountController& mount, CameraController& camera, Clock& clock)
             : _mount(mount), _camera(camera), _clock(clock) {}
@@ -77,7 +78,7 @@ class Control {
         template <class T> 
           void save(T value, uint16_t adress) {
             byte* p = (byte*)(void*)&value;
-            for (int i = 0; i < sizeof(value); i++) EEPROM.write(adress++, *p++);
+            for (int i = 0; i < sizeof(value); i++) hal::eeprom_update(adress++, *p++);
         }
 
         template <class T>
@@ -90,7 +91,7 @@ class Control {
         template <class T>
         void load(T& target, uint16_t adress) {
             byte* p = (byte*)(void*)&target;
-            for (int i = 0; i < sizeof(target); i++) *p++ = EEPROM.read(adress++);
+            for (int i = 0; i < sizeof(target); i++) *p++ = hal::eeprom_read(adress++);
         }
 
         // display global position, facilitate manual controll and motors stopping
@@ -119,6 +120,10 @@ class Control {
 
         void help_menu();
 
+        // warning that the mount refused a slew, after INFO_SCREEN_MS it returns to the menu go_to
+        // was called from (without resetting it, it is just redrawn)
+        void unsafe_menu();
+
         void manual_control(ControlSubState nothing, ControlSubState degrees, ControlSubState minutes, ControlSubState seconds);
 
         void clear_position_buffers();
@@ -129,6 +134,12 @@ class Control {
         // longer time (which is used in this code to alter sign of the number being specified)
         int get_pushed_digit();
 
+        // starts a slew to the target (J2000 if 'j2000'), displays a warning if the mount refused it
+        void go_to(MountController::coord_t target, bool j2000);
+
+        // loads the keep-out map of the mount from KEEP_OUT_FILE, returns false if there is no file
+        bool import_keep_out();
+
         // search in a catalogue file on the SD card for the specified object with number 'object'
         bool find_in_catalogue(ControlSubState catalogue, int object, MountController::coord_t& coords, 
                                float& magnitude, float& size_a, float& size_b, char type[5]);
@@ -145,7 +156,7 @@ class Control {
             _substate = ControlSubState::S0;
             _substate_changed = false;
             _state_changed = true;
-            _last_substate_change_time = millis();
+            _last_substate_change_time = Clock::millis();
         }
 
         inline void change_substate(ControlSubState new_state) {
@@ -158,13 +169,17 @@ class Control {
         }
 
         State _state;
-        ControlSubState _substate;
+        ControlSubState _substate = S0;
         bool _state_changed = false;
         bool _substate_changed = false;
         bool _last_state_changed = false;
         bool _last_substate_changed = false;
         unsigned long _last_substate_change_time = 0;
 
+        // the menu to return to from an informative state (UNSAFE)
+        State _info_return_state = MAIN;
+        ControlSubState _info_return_substate = S0;
+
         int _ra_buffer[3];
         int _dec_buffer[3];
         int _time[6];
@@ -176,8 +191,6 @@ class Control {
 
         int _brightness_buffer = 128;
 
-        SDClass* _sd;
-
         Display _display;
         Keypad _keypad;
         
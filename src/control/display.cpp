@@ -112,8 +112,8 @@ void Display::render_position(bool refresh, float ra, float dec) {
         _lcd.setCursor(0, 1); _lcd.print(F("D:"));
     }
 
-    if (millis() - _last_refresh < DSP_REFRESH_MS && !refresh) return;
-    _last_refresh = millis();
+    if (Clock::millis() - _last_refresh < DSP_REFRESH_MS && !refresh) return;
+    _last_refresh = Clock::millis();
 
     int his_ra[3];  dec_to_his(ra, his_ra);
     int dms_dec[3]; dec_to_dms(dec, dms_dec);
@@ -128,8 +128,8 @@ void Display::render_main(bool refresh, ControlSubState phase, const DateTime& l
         _lcd.setCursor(0, 0); _lcd.print(F("LST:"));      
     }
 
-    if (millis() - _last_refresh < DSP_REFRESH_MS && !refresh) return;
-    _last_refresh = millis();
+    if (Clock::millis() - _last_refresh < DSP_REFRESH_MS && !refresh) return;
+    _last_refresh = Clock::millis();
 
     _lcd.setCursor(5, 0);  print_padded(lst.hour(), 2); _lcd.print(F("h "));
     _lcd.setCursor(9, 0); print_padded(lst.minute(), 2); _lcd.print(F("m "));
@@ -338,8 +338,8 @@ void Display::render_calibration_alignment(bool refresh, ControlSubState phase)
         _lcd.print(F("Confirm (cal.k.)"));
     }
 
-    if (millis() - _last_refresh > DSP_REFRESH_MS || refresh) {
-        _last_refresh = millis();
+    if (Clock::millis() - _last_refresh > DSP_REFRESH_MS || refresh) {
+        _last_refresh = Clock::millis();
         _lcd.setCursor(DSP_COLS - 1 - 3, 1); 
         print_manual(phase);
     }
@@ -446,6 +446,17 @@ void Display::render_not_found(bool refresh) {
     _lcd.print(F("It is a pity :(")); 
 }
 
+void Display::render_unsafe(bool refresh) {
+
+    if (!refresh) return;
+
+    _lcd.clear(); 
+    _lcd.setCursor(0, 0); 
+    _lcd.print(F("Cannot go there")); 
+    _lcd.setCursor(0, 1); 
+    _lcd.print(F("Keep-out zone!")); 
+}
+
 void Display::render_brightness(bool refresh, int brightness, bool changed) {
 
     if (refresh) {
@@ -514,6 +525,7 @@ void Display::print_padded(int number, int characters) {
     itoa(number, digits, 10);
     int n = 0;
     for (; n < 8; ++n) if (digits[n] == '\0') break;
+    if (n > characters) n = characters;
 
     char str[8];
     for (int i = 0; i < characters - n; ++i) str[i] = ' ';
@@ -548,8 +560,9 @@ void Display::print_padded_float(float number, int characters) {
 
 void Display::dec_to_dms(float decimal, int dms[3]) {
     dms[0] = (int)decimal;
-    dms[1] = (int)((decimal - dms[0]) * 60.0f);
-    dms[2] = (int)((decimal - dms[0] - dms[1] / 60.0f) * 3600.0f);
+    decimal = fabs(decimal - dms[0]);
+    dms[1] = (int)(decimal * 60.0f);
+    dms[2] = (int)((decimal - dms[1] / 60.0f) * 3600.0f);
 }
 
 void Display::dec_to_his(float decimal, int his[3]) {
@@ -559,9 +572,9 @@ void Display::dec_to_his(float decimal, int his[3]) {
 
 bool Display::should_blink() {
 
-    if (millis() - _last_blink < DPS_BLINKING_MS) return false; 
+    if (Clock::millis() - _last_blink < DPS_BLINKING_MS) return false; 
 
-    _last_blink = millis();
+    _last_blink = Clock::millis();
     _blink = !_blink;
     return true;
 }
\ No newline at end of file
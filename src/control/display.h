@@ -1,12 +1,9 @@
 #ifndef DISPLAY_H
 #define DISPLAY_H
 
-#include <Arduino.h>
-#include <Wire.h> 
-#include <LiquidCrystal.h>
-
 #include "../core/clock.h"
 #include "../config.h"
+#include "../hal/hal.h"
 
 #define DSP_ROWS            2
 #define DSP_COLS            16
@@ -19,8 +16,8 @@ class Display {
     
     public:
 
-        Display() : _lcd(LiquidCrystal(DSP_REGISTER_SEL_PIN, DSP_ENABLE_PIN, DSP_DATA_PIN7, 
-                                       DSP_DATA_PIN6, DSP_DATA_PIN5, DSP_DATA_PIN4)) {}
+        Display() : _lcd(hal::CharLcd(DSP_REGISTER_SEL_PIN, DSP_ENABLE_PIN, DSP_DATA_PIN7, 
+                                            DSP_DATA_PIN6, DSP_DATA_PIN5, DSP_DATA_PIN4)) {}
 
         // initialize LCD and display intro screen
         void initialize(int brightness);
@@ -79,6 +76,9 @@ class Display {
         // simple "entry not found" screen
         void render_not_found(bool refresh);
 
+        // the target is in the keep-out map or out of limits of the mount
+        void render_unsafe(bool refresh);
+
         // catalogue search results, display the object info including magnitude, size and type
         void render_catalogue_results(bool refresh, ControlSubState phase, int object_number, float magnitude, float size_a, float size_b, char type[5]);
 
@@ -110,7 +110,7 @@ class Display {
         // changes state of _blink according to last blink time, true if changed, false otherwise
         bool should_blink();
 
-        LiquidCrystal _lcd;
+        hal::CharLcd _lcd;
 
         bool _blink = false;
         unsigned long _last_blink = 0;
@@ -1,7 +1,9 @@
 #ifndef KEYPAD_H
 #define KEYPAD_H
 
-#include <IRremote.h>
+#include "../hal/hal.h"
+#include "../core/ir_receiver.h"
+#include "../core/log.h"
 
 #define KP_KEY_A             0xFFA25D
 #define KP_KEY_B             0xFF629D
@@ -25,78 +27,69 @@
 #define KP_KEY_LEFT_ARROW    0xFFE01F
 #define KP_KEY_OK            0xFFA857
 
-#define KP_UPDATE_MS         200     
-
 class Keypad {
 
     public:
 
-        Keypad() : _recv(IRrecv(KEYPAD_IR_PIN)) {}
-
-        void initialize() {
-            _recv.enableIRIn();
-            _recv.blink13(false);
+        // 'hold_keys' are the keys which may be taken as pressed, they must outlive the keypad
+        void initialize(const uint32_t* hold_keys, uint8_t hold_keys_count) {
+            _hold_keys = hold_keys;
+            _hold_keys_count = hold_keys_count;
+            IrReceiver::initialize();
         }
 
-        // returns true if the given key was pressed for longer than SHORT_HOLD_TIME_MS
-        inline boolean pushed(uint32_t key_code) { return pressed_internal(key_code, SHORT_HOLD_TIME_MS); }
+        // returns true if the given key was pushed, a hold key when it was released (and was not
+        // taken as pressed before), any other key as soon as its frame came
+        inline boolean pushed(uint32_t key_code) { return take(key_code, false); }
 
-        // returns true if the given key was pressed for longer than LONG_HOLD_TIME_MS
-        inline boolean pressed(uint32_t key_code) { return pressed_internal(key_code, LONG_HOLD_TIME_MS); }
+        // returns true if the given hold key has been held for LONG_HOLD_TIME_MS (while still held)
+        inline boolean pressed(uint32_t key_code) { return take(key_code, true); }
 
+        // takes the next key event decoded by the interrupt, a single event per call
         void update() {
 
-            _hold_time = 0;
+            _has_event = false;
 
-            if (_last_used_key == 0 && (millis() - _last_update) < KP_UPDATE_MS) return;
-            _last_update = millis();
-
-            uint32_t new_key = get_key();
-          
-            if (new_key == _used_key) return;
+            IrReceiver::event_t event;
+            if (!IrReceiver::pop(event)) return;
 
             #ifdef DEBUG_KEYS
-                Serial.print(F("Keypad change: "));
-                Serial.print(_used_key, HEX);
-                Serial.print(F("-->"));
-                Serial.println(new_key, HEX);
+                LOG(KEY_EVENT, (unsigned int)event.type, event.key, event.ms);
             #endif
 
-            _last_used_key = _used_key;
-            _used_key = new_key;
-            _hold_time = millis() - _press_time;
-            _press_time = millis();
+            // a hold key is pushed by its release unless it was taken as pressed, other keys by
+            // their frame, their holds and releases are nothing
+            bool hold_key = is_hold_key(event.key);
+            if (event.type == IrReceiver::IR_KEY_PRESS) {
+                _held = false;
+                if (hold_key) return;
+            }
+            else if (!hold_key || (event.type == IrReceiver::IR_KEY_RELEASE && _held)) return;
+
+            _event = event;
+            _has_event = true;
         }
 
     private:
 
-        inline bool pressed_internal(uint32_t key_code, unsigned long duration) {
-            if (key_code != _last_used_key) return false; 
-            if (_hold_time >= duration) {
-                _hold_time = 0;
-                return true;
-            } else return false;
+        inline bool take(uint32_t key_code, bool hold) {
+            if (!_has_event || _event.key != key_code || (_event.type == IrReceiver::IR_KEY_HOLD) != hold) return false;
+            _has_event = false;
+            if (hold) _held = true;
+            return true;
         }
 
-        uint32_t get_key() {
-
-            decode_results results;
-            if (!_recv.decode(&results)) return 0;
-
-            _recv.resume();
-
-            return (results.value == 0xFFFFFFFF ? _used_key : results.value) ;
+        bool is_hold_key(uint32_t key_code) const {
+            for (uint8_t i = 0; i < _hold_keys_count; ++i) if (_hold_keys[i] == key_code) return true;
+            return false;
         }
 
-        IRrecv _recv;
-
-        uint32_t _used_key = 0;         // currently pressed key
-        uint32_t _last_used_key = 0;    // key pressed before previous key change
-
-        unsigned long _hold_time = 0;   // millis since last key change
-        unsigned long _press_time = 0;  // millis of last key change
+        IrReceiver::event_t _event;     // the event of this update
+        bool _has_event = false;        // the event was not taken yet
+        bool _held = false;             // the hold of the last key was taken by pressed()
 
-        unsigned long _last_update = 0; // millis since last key check
+        const uint32_t* _hold_keys = nullptr;
+        uint8_t _hold_keys_count = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef ANGLE_H
+#define ANGLE_H
+
+#include <stdint.h>
+#include <math.h>
+
+#include "../config.h"
+
+// Binary angles (BAM), the whole range of 32 bit unsigned integer corresponds to a single
+// turn (360 degrees), so any addition or subtraction wraps around 360 degrees exactly. The
+// 64 bit variant has the same fraction of turn in its lower 32 bits, but the upper bits
+// count whole turns, so it can describe positions of the RA axis which must not be wrapped.
+using bam_t = uint32_t;
+using bam64_t = int64_t;
+
+#define BAM_PER_DEG     11930464.7111111   // 2^32 / 360
+#define BAM_TURN        4294967296LL       // a full turn as bam64_t
+#define DEG_PER_BAM     8.38190317154e-8   // 360 / 2^32
+
+// converts degrees to a binary angle, wraps around 360 degrees (use only at UI boundary)
+inline bam_t deg_to_bam(float deg) {
+    return (bam_t)(int64_t)(fmod(deg, 360) * BAM_PER_DEG);
+}
+
+// converts binary angle to degrees in range 0..360
+inline float bam_to_deg(bam_t angle) {
+    return angle * DEG_PER_BAM;
+}
+
+// converts binary angle to degrees in range -180..180
+inline float bam_to_signed_deg(bam_t angle) {
+    return (int32_t)angle * DEG_PER_BAM;
+}
+
+// converts 64 bit binary angle to degrees including whole turns
+inline float bam64_to_deg(bam64_t angle) {
+    return (int32_t)(angle >> 32) * 360.0f + bam_to_deg((bam_t)angle);
+}
+
+// largest shift for which the binary angle of a single motor pulse still fits into 32 bits
+constexpr uint8_t bam_shift(float pulses_per_turn, uint8_t shift = 0) {
+    return (shift < 31 && (float)(1UL << (shift + 1)) < pulses_per_turn) ? bam_shift(pulses_per_turn, shift + 1) : shift;
+}
+
+// binary angle of a single motor pulse scaled by 2^shift
+constexpr uint32_t bam_per_pulse(float pulses_per_turn, uint8_t shift) {
+    return 4294967296.0 * (1UL << shift) / pulses_per_turn + 0.5;
+}
+
+#endif
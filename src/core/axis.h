@@ -0,0 +1,112 @@
+#ifndef AXIS_H
+#define AXIS_H
+
+#include <stdint.h>
+#include <math.h>
+
+#include "../config.h"
+#include "angle.h"
+
+// Gears and motor of a mount axis given by config.h, see Axis
+struct DecConfig {
+    static constexpr double steps_per_rev = STEPS_PER_REV_DEC;
+    static constexpr double reduction_ratio = REDUCTION_RATIO_DEC;
+    static constexpr double deg_per_mount_rev = DEG_PER_MOUNT_REV_DEC;
+};
+
+struct RaConfig {
+    static constexpr double steps_per_rev = STEPS_PER_REV_RA;
+    static constexpr double reduction_ratio = REDUCTION_RATIO_RA;
+    static constexpr double deg_per_mount_rev = DEG_PER_MOUNT_REV_RA;
+};
+
+// A quantity of a single axis (motor revolutions, balance of pulses), a distinct type for each
+// Config, so a DEC quantity passed to a conversion of RA does not compile. It reads as a plain
+// number anywhere, but it is made only explicitly, e.g. Ra::revs_t(revs.ra).
+template <class Config, class T>
+struct axis_value_t {
+    T value;
+
+    constexpr axis_value_t() : value(0) {}
+    explicit constexpr axis_value_t(T value) : value(value) {}
+    constexpr operator T() const { return value; }
+
+    axis_value_t& operator+=(axis_value_t other) { value += other.value; return *this; }
+    axis_value_t& operator-=(axis_value_t other) { value -= other.value; return *this; }
+};
+
+// Unit conversions of a mount axis, all the ratios of degrees, motor revolutions, steps and
+// pulses (a pulse is a single change of the STEP pin and a full step is made of 2 *
+// MICROSTEPPING_MUL pulses with microstepping enabled, the balance of MotorController is
+// counted in these units) are derived at compile time, so any conversion is a single multiply
+// (or a multiply and a shift for binary angles) and wrong gears do not compile at all.
+template <class Config>
+struct Axis {
+
+    using revs_t = axis_value_t<Config, float>;  // motor revolutions
+    using pulses_t = axis_value_t<Config, long>;  // balance of pulses
+
+    static constexpr float STEPS_PER_REV       = Config::steps_per_rev;
+    static constexpr float MICROSTEPS_PER_REV  = Config::steps_per_rev * MICROSTEPPING_MUL;
+    static constexpr float REVS_PER_STEP       = 1.0 / STEPS_PER_REV;
+    static constexpr float REVS_PER_MICROSTEP  = 1.0 / MICROSTEPS_PER_REV;
+    static constexpr float REVS_PER_PULSE      = 0.5 / MICROSTEPS_PER_REV;
+    static constexpr float REVS_PER_DEG        = Config::reduction_ratio / Config::deg_per_mount_rev;
+    static constexpr float PULSES_PER_TURN     = 2.0 * MICROSTEPPING_MUL * Config::steps_per_rev * Config::reduction_ratio * 360.0 / Config::deg_per_mount_rev;
+    static constexpr float REVS_PER_BAM        = Config::reduction_ratio * 360.0 / Config::deg_per_mount_rev / 4294967296.0;
+    static constexpr float BAM_PER_REV         = 4294967296.0 * Config::deg_per_mount_rev / Config::reduction_ratio / 360.0;
+
+    // binary angle of a single pulse is BAM_PER_PULSE / 2^BAM_SHIFT
+    static constexpr uint8_t  BAM_SHIFT        = bam_shift(PULSES_PER_TURN);
+    static constexpr uint32_t BAM_PER_PULSE    = bam_per_pulse(PULSES_PER_TURN, BAM_SHIFT);
+
+    static_assert(Config::steps_per_rev >= 1, "Motor must have at least one step per revolution!");
+    static_assert(Config::reduction_ratio > 0 && Config::deg_per_mount_rev > 0, "Gear ratios must be positive!");
+    static_assert(PULSES_PER_TURN >= 2, "Mount gears are not configured properly!");
+    static_assert(PULSES_PER_TURN * 3 < 2147483647.0, "Pulse balance of three turns of the mount would overflow!");
+    static_assert(MICROSTEPPING_MUL >= 1 && (MICROSTEPPING_MUL & (MICROSTEPPING_MUL - 1)) == 0,
+                  "Microstepping must be a power of two!");
+
+    static inline revs_t deg_to_revs(float deg) { return revs_t(deg * REVS_PER_DEG); }
+
+    static inline float revs_to_steps(revs_t revs, bool microstepping) {
+        return fabs(revs.value) * (microstepping ? MICROSTEPS_PER_REV : STEPS_PER_REV);
+    }
+
+    static inline revs_t steps_to_revs(float steps, bool microstepping) {
+        return revs_t(steps * (microstepping ? REVS_PER_MICROSTEP : REVS_PER_STEP));
+    }
+
+    static inline revs_t pulses_to_revs(pulses_t pulses) { return revs_t(pulses.value * REVS_PER_PULSE); }
+
+    // balance of pulses made by a microstepping turn by 'revs' (the nearest number of microsteps)
+    static inline pulses_t revs_to_pulses(revs_t revs) {
+        long pulses = 2 * (long)(revs_to_steps(revs, true) + 0.5f);
+        return pulses_t(revs.value < 0 ? -pulses : pulses);
+    }
+
+    // motor revolutions of the difference of two binary angles of the axis
+    static inline revs_t bam_to_revs(bam64_t angle) { return revs_t((float)angle * REVS_PER_BAM); }
+
+    static inline bam64_t revs_to_bam(revs_t revs) { return (bam64_t)(revs.value * BAM_PER_REV); }
+
+    // converts balance of motor pulses to the angle of the axis (single multiply and shift)
+    static inline bam64_t pulses_to_bam(pulses_t pulses) { return ((int64_t)pulses.value * BAM_PER_PULSE) >> BAM_SHIFT; }
+};
+
+template <class C> constexpr float Axis<C>::STEPS_PER_REV;
+template <class C> constexpr float Axis<C>::MICROSTEPS_PER_REV;
+template <class C> constexpr float Axis<C>::REVS_PER_STEP;
+template <class C> constexpr float Axis<C>::REVS_PER_MICROSTEP;
+template <class C> constexpr float Axis<C>::REVS_PER_PULSE;
+template <class C> constexpr float Axis<C>::REVS_PER_DEG;
+template <class C> constexpr float Axis<C>::PULSES_PER_TURN;
+template <class C> constexpr float Axis<C>::REVS_PER_BAM;
+template <class C> constexpr float Axis<C>::BAM_PER_REV;
+template <class C> constexpr uint8_t Axis<C>::BAM_SHIFT;
+template <class C> constexpr uint32_t Axis<C>::BAM_PER_PULSE;
+
+using DecAxis = Axis<DecConfig>;
+using RaAxis  = Axis<RaConfig>;
+
+#endif
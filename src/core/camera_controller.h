@@ -2,6 +2,7 @@
 #define CAMERACONTROLLER_H
 
 #include "../config.h"
+#include "../hal/hal.h"
 
 class CameraController {
   
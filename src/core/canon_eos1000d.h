@@ -3,6 +3,7 @@
 
 #include "../config.h"
 #include "camera_controller.h"
+#include "clock.h"
 
 class CanonEOS1000D : public CameraController {
 
@@ -18,12 +19,12 @@ class CanonEOS1000D : public CameraController {
             digitalWrite(TRIGGER_PIN, HIGH);
             _last_delay = delay_ms ;
             _last_duration = duration_ms;
-            _last_invoked = millis();
+            _last_invoked = Clock::millis();
         }
 
         boolean update() override {
             
-            long from_last_snap = millis() - _last_invoked;
+            long from_last_snap = Clock::millis() - _last_invoked;
 
             if (from_last_snap < _last_duration) return true;
             if (from_last_snap < _last_duration + SNAP_DELAY_MS) {
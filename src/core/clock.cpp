@@ -1,3 +1,10 @@
 #include "clock.h"
 
-TimeSpan Clock::_local_siderial_time_offset = TimeSpan();
\ No newline at end of file
+static BoardTime board_time;
+
+TimeSource* Clock::_source = &board_time;
+uint32_t Clock::_time_unix = SECONDS_FROM_1970_TO_2000;
+uint32_t Clock::_time_millis = 0;
+
+uint64_t Clock::_lst = 0;
+uint32_t Clock::_lst_micros = 0;
\ No newline at end of file
@@ -1,20 +1,16 @@
 #ifndef CLOCK_H
 #define CLOCK_H
 
-#include <Arduino.h>
-#include <RTClib.h>
-
 #include "../config.h"
+#include "../hal/hal.h"
+#include "angle.h"
+#include "time_source.h"
+#include "log.h"
 
-class SubSecondRTC : public RTC_Millis {
-    public:
-        static void adjust(const DateTime& dt) { RTC_Millis::adjust(dt); }
-        static void adjust(uint32_t t = SECONDS_FROM_1970_TO_2000) { RTC_Millis::adjust(DateTime(t)); }
-        static void adjust(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0) {
-            RTC_Millis::adjust(DateTime(year, month, day, hour, min, sec));
-        }      
-        static uint32_t sub_second_millis() { return millis() - lastMillis; } 
-};
+// LST advances by 2^64 / 86164090500 (one sidereal day in micros) per microsecond, the 
+// number is split into the integer part and a 32 bit fraction to keep the LST exact
+#define LST_PER_MICROS_HIGH     214088536UL
+#define LST_PER_MICROS_LOW      4126932839UL
 
 class Clock  {
 
@@ -26,28 +22,77 @@ class Clock  {
         // adjust internal clocks and synchronize RTC module if needed
         virtual void sync(const DateTime& dt) = 0;
 
+        // replaces the time source (the board time by default), the time and LST continue from 
+        // their current values, so the clock can be switched to a virtual time and back at any time
+        static void set_time_source(TimeSource& source) {
+            update();
+            get_time();
+            uint32_t sub_second = millis() - _time_millis;
+            _source = &source;
+            _time_millis = millis() - sub_second;
+            _lst_micros = micros();
+        }
+
+        // time of the time source, use instead of millis() and micros() of the board for everything
+        // which should follow the clock (timeouts of the user interface, camera exposures, ...)
+        static unsigned long millis() { return _source->millis(); }
+        static unsigned long micros() { return _source->micros(); }
+
         // returns current datetime
-        static DateTime get_time() { return _time.now(); }
+        static DateTime get_time() { 
+            uint32_t elapsed_seconds = (uint32_t)(millis() - _time_millis) / 1000;
+            _time_millis += elapsed_seconds * 1000;
+            _time_unix += elapsed_seconds;
+            return DateTime(_time_unix);
+        }
 
         // returns current datetime in decimal format with subsecond precision
         static double get_decimal_time() { 
-            auto dt = _time.now();
-            return dt.hour() + dt.minute() / 60.0 + ((float)dt.second() + _time.sub_second_millis() / 1000.0) / 3600.0;
+            auto dt = get_time();
+            return dt.hour() + dt.minute() / 60.0 + ((float)dt.second() + (uint32_t)(millis() - _time_millis) / 1000.0) / 3600.0;
         }
 
-        // returns current local siderial time with precission of seconds
-        static DateTime get_LST() { return _time.now() + _local_siderial_time_offset; }
+        // advances the local siderial time, must be called at least once an hour (call from loop)
+        static void update() {
+            uint32_t now = micros();
+            uint32_t elapsed = now - _lst_micros;
+            _lst_micros = now;
+            _lst += (uint64_t)elapsed * LST_PER_MICROS_HIGH + (((uint64_t)elapsed * LST_PER_MICROS_LOW) >> 32);
+        }
+
+        // returns current local siderial time as a binary angle (full turn is 24 hours), 
+        // the resolution is about 20 us and it costs just a few integer operations
+        static bam_t get_LST_angle() { 
+            update();
+            return _lst >> 32; 
+        }
+
+        // returns current local siderial time with precission of seconds (the date is meaningless)
+        static DateTime get_LST() { 
+            return DateTime(SECONDS_FROM_1970_TO_2000 + (uint32_t)(((uint64_t)get_LST_angle() * 86400UL) >> 32)); 
+        }
 
         // returns current local siderial time with subsecond precission in decimal format
         static double get_decimal_LST() { 
-            auto dt = _time.now() + _local_siderial_time_offset;
-            return dt.hour() + dt.minute() / 60.0 + ((float)dt.second() + _time.sub_second_millis() / 1000.0f) / 3600.0f;   
+            return get_LST_angle() * (24.0 / 4294967296.0);   
         }
 
     protected:
 
-        // compute local siderial time, precision of few arc seconds
-        static TimeSpan compute_LST_offset() {
+        // sets the datetime, it is then advanced by millis() of the time source
+        static void set_time(const DateTime& dt) {
+            _time_millis = millis();
+            _time_unix = dt.unixtime();
+        }
+
+        // anchors the local siderial time, it is then advanced by micros() scaled to siderial time
+        static void set_LST(double decimal_lst) {
+            _lst_micros = micros();
+            _lst = (uint64_t)(uint32_t)(decimal_lst / 24.0 * 4294967296.0) << 32;
+        }
+
+        // compute local siderial time (decimal hours), precision of few arc seconds
+        static double compute_LST() {
 
             // Arduino cannot handle 64 bit floats so this
             // https://aa.usno.navy.mil/faq/docs/GAST.php
@@ -62,7 +107,7 @@ class Clock  {
             double D1 = (367L * dt.year()) - 730531.5;
             double D2 = D1 - (long)((7.0 * (dt.year() + (long)((dt.month() + 9.0) / 12.0f))) / 4.0);
             
-            double D3 = (long)(30.55555555 * dt.month()) + dt.day();
+            double D3 = 275L * dt.month() / 9 + dt.day();
             double D4 = D3 + dt_d / 24.0;
             
             long LD2 = D2;
@@ -76,17 +121,21 @@ class Clock  {
             GMST += 18.697374558 + LONGITUDE / 15.0;
 
             #ifdef DEBUG_TIME
-                Serial.print(F("Local siderial time: ")); Serial.println(fmod(GMST, 24.0f), 5);
+                LOG(LST, fmod(GMST, 24.0f));
             #endif
 
-            double GMST_diff = fmod(GMST, 24.0f) - dt_d;
-            if (GMST_diff < 0) GMST_diff += 24.0f;
-
-            return TimeSpan(GMST_diff * 3600.0);
+            return fmod(GMST, 24.0f);
         }
 
-        static SubSecondRTC _time;
-        static TimeSpan     _local_siderial_time_offset;
+        static TimeSource*  _source;
+
+        // datetime (unix seconds) at _time_millis
+        static uint32_t     _time_unix;
+        static uint32_t     _time_millis;
+
+        // LST at _lst_micros as a fraction of siderial day (2^64 is the whole day)
+        static uint64_t     _lst;
+        static uint32_t     _lst_micros;
 };
 
 #endif
\ No newline at end of file
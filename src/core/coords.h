@@ -0,0 +1,172 @@
+#ifndef COORDS_H
+#define COORDS_H
+
+#include <stdint.h>
+#include <math.h>
+
+#include "../config.h"
+#include "angle.h"
+#include "trig.h"
+
+// Spherical coordinate math used by MountController, templated on the scalar type of cartesian
+// vectors and rotation matrices, so the same code runs with float (which is also what double is
+// on AVR), true 64 bit double (hosts, ARM boards) or fixed_t (below) chosen by MOUNT_REAL. Polar
+// coordinates are always float degrees. Functions which depend on the scalar type (trigonometry,
+// square root) are in scalar_math<T>.
+
+struct polar_t { float dec; float ra; };
+
+// Fixed point number in Q2.29 format (range -4..4, resolution 1.9e-9), which is enough for unit
+// vectors and rotation matrices. It is made from float implicitly, but must be converted back
+// explicitly, so mixed expressions are evaluated in fixed point.
+struct fixed_t {
+
+    static constexpr uint8_t FRACTION_BITS = 29;
+
+    int32_t raw;
+
+    fixed_t() = default;
+    constexpr fixed_t(float value) : raw(value * (float)(1L << FRACTION_BITS) + (value < 0 ? -0.5f : 0.5f)) {}
+    explicit operator float() const { return raw * (1.0f / (1L << FRACTION_BITS)); }
+
+    static fixed_t from_raw(int32_t raw) { fixed_t f; f.raw = raw; return f; }
+
+    fixed_t operator-() const { return from_raw(-raw); }
+    fixed_t& operator+=(fixed_t b) { raw += b.raw; return *this; }
+    fixed_t& operator-=(fixed_t b) { raw -= b.raw; return *this; }
+    fixed_t& operator*=(fixed_t b) { raw = ((int64_t)raw * b.raw) >> FRACTION_BITS; return *this; }
+    fixed_t& operator/=(fixed_t b) { raw = ((int64_t)raw << FRACTION_BITS) / b.raw; return *this; }
+
+    friend fixed_t operator+(fixed_t a, fixed_t b) { return a += b; }
+    friend fixed_t operator-(fixed_t a, fixed_t b) { return a -= b; }
+    friend fixed_t operator*(fixed_t a, fixed_t b) { return a *= b; }
+    friend fixed_t operator/(fixed_t a, fixed_t b) { return a /= b; }
+
+    friend bool operator<(fixed_t a, fixed_t b)  { return a.raw < b.raw; }
+    friend bool operator>(fixed_t a, fixed_t b)  { return a.raw > b.raw; }
+    friend bool operator<=(fixed_t a, fixed_t b) { return a.raw <= b.raw; }
+    friend bool operator>=(fixed_t a, fixed_t b) { return a.raw >= b.raw; }
+};
+
+template <class T> struct scalar_math;
+
+template <> struct scalar_math<float> {
+
+    // sine and cosine of an angle given in degrees, see FAST_TRIG
+    static void sin_cos(float deg, float& sine, float& cosine) {
+        #ifdef FAST_TRIG
+            fast_sincos(deg, sine, cosine);
+        #else
+            sine = sin(deg / 180 * M_PI);
+            cosine = cos(deg / 180 * M_PI);
+        #endif
+    }
+
+    // angle of the vector (x, y) in degrees in range -180..180 and optionally its length
+    static float atan2(float y, float x, float* length = nullptr) {
+        #ifdef FAST_TRIG
+            return fast_atan2(y, x, length);
+        #else
+            if (length) *length = ::sqrt(x * x + y * y);
+            return ::atan2(y, x) / M_PI * 180;
+        #endif
+    }
+
+    static float sqrt(float x) { return ::sqrt(x); }
+};
+
+template <> struct scalar_math<double> {
+
+    static void sin_cos(float deg, double& sine, double& cosine) {
+        sine = ::sin(deg / 180.0 * M_PI);
+        cosine = ::cos(deg / 180.0 * M_PI);
+    }
+
+    static float atan2(double y, double x, double* length = nullptr) {
+        if (length) *length = ::sqrt(x * x + y * y);
+        return ::atan2(y, x) / M_PI * 180.0;
+    }
+
+    static double sqrt(double x) { return ::sqrt(x); }
+};
+
+template <> struct scalar_math<fixed_t> {
+
+    static void sin_cos(float deg, fixed_t& sine, fixed_t& cosine) {
+        int32_t s, c;
+        bam_sincos(deg_to_bam(deg), s, c);
+        sine = fixed_t::from_raw(s >> (30 - fixed_t::FRACTION_BITS));
+        cosine = fixed_t::from_raw(c >> (30 - fixed_t::FRACTION_BITS));
+    }
+
+    static float atan2(fixed_t y, fixed_t x, fixed_t* length = nullptr) {
+        if (length) *length = sqrt(x * x + y * y);
+        return bam_to_signed_deg(bam_atan2(y.raw, x.raw));
+    }
+
+    static fixed_t sqrt(fixed_t x) { return ::sqrt((float)x); }
+};
+
+template <class T>
+struct cartesian { T x; T y; T z; };
+
+template <class T>
+struct matrix {
+
+    T data[3][3];
+
+    matrix& operator*= (matrix const & b){
+        matrix product = {};
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                for (int k = 0; k < 3; k++) {
+                    product.data[i][j] += data[i][k] * b.data[k][j];
+                }
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++){
+                data[i][j] = product.data[i][j];
+            }
+        return *this;
+    }
+
+    friend matrix operator*(matrix left, matrix const & right) {
+        left *= right;
+        return left;
+    }
+
+    friend cartesian<T> operator*(matrix const & left, cartesian<T> const & right) {
+        return cartesian<T> {
+            left.data[0][0] * right.x + left.data[0][1] * right.y + left.data[0][2] * right.z,
+            left.data[1][0] * right.x + left.data[1][1] * right.y + left.data[1][2] * right.z,
+            left.data[2][0] * right.x + left.data[2][1] * right.y + left.data[2][2] * right.z,
+        };
+    }
+};
+
+// converts spherical coordinates with unit radius to cartesian
+template <class T>
+cartesian<T> polar_to_cartesian(polar_t polar) {
+
+    T sin_dec, cos_dec, sin_ra, cos_ra;
+    scalar_math<T>::sin_cos(polar.dec, sin_dec, cos_dec);
+    scalar_math<T>::sin_cos(polar.ra,  sin_ra,  cos_ra);
+
+    return cartesian<T> { cos_dec * cos_ra,
+                          cos_dec * sin_ra,
+                          sin_dec };
+}
+
+// converts cartesian to spherical coordinates, DEC is computed from atan2 with the length of
+// the XY projection instead of asin, which keeps precision near poles and handles non-unit
+// vectors (and the length is just a byproduct of CORDIC with FAST_TRIG)
+template <class T>
+polar_t cartesian_to_polar(cartesian<T> cartesian) {
+
+    T xy_length;
+    float ra = scalar_math<T>::atan2(cartesian.y, cartesian.x, &xy_length);
+    if (ra < 0) ra += 360;
+
+    return polar_t { scalar_math<T>::atan2(cartesian.z, xy_length), ra };
+}
+
+#endif
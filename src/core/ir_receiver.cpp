@@ -0,0 +1,127 @@
+#include "ir_receiver.h"
+
+IrReceiver::event_t IrReceiver::_events[IR_EVENTS_SIZE];
+volatile uint8_t IrReceiver::_head = 0;
+volatile uint8_t IrReceiver::_tail = 0;
+
+bool IrReceiver::_mark = false;
+unsigned long IrReceiver::_edge_us = 0;
+IrReceiver::state_t IrReceiver::_state = IDLE;
+uint8_t IrReceiver::_bits = 0;
+uint32_t IrReceiver::_code = 0;
+
+uint32_t IrReceiver::_key = 0;
+unsigned long IrReceiver::_press_ms = 0;
+unsigned long IrReceiver::_last_ms = 0;
+unsigned long IrReceiver::_last_us = 0;
+bool IrReceiver::_held = false;
+
+bool IrReceiver::pop(event_t& event) {
+
+    if (_head == _tail) return false;
+
+    // the interrupt does not touch the slot until the tail moves
+    event = _events[_tail & (IR_EVENTS_SIZE - 1)];
+    _tail = _tail + 1;
+    return true;
+}
+
+void IrReceiver::edge(bool mark, unsigned long us) {
+
+    // NEC frame: leader 9 ms pulse, 4.5 ms space, 32 bits (562.5 us pulse and 562.5 us space
+    // for 0 or 1687.5 us space for 1, the most significant first) and a stop pulse, a repeat
+    // frame is the leader pulse, 2.25 ms space and the stop pulse
+    if (mark) {
+
+        if (us >= 7000 && us <= 11000) {
+            _state = LEADER;
+            return;
+        }
+
+        if (us < 250 || us > 900) _state = IDLE;
+        else if (_state == STOP) frame(_code);
+        else if (_state == REPEAT) frame(0xFFFFFFFF);
+        else if (_state == BITS) return;
+
+        _state = IDLE;
+        return;
+    }
+
+    switch (_state) {
+
+        case LEADER:
+            if (us >= 3500 && us <= 5500) {
+                _state = BITS;
+                _bits = 0;
+                _code = 0;
+            }
+            else if (us >= 1700 && us <= 2800) _state = REPEAT;
+            else _state = IDLE;
+            break;
+
+        case BITS:
+            if (us >= 250 && us <= 900) _code <<= 1;
+            else if (us >= 1300 && us <= 2200) _code = _code << 1 | 1;
+            else {
+                _state = IDLE;
+                break;
+            }
+            if (++_bits == 32) _state = STOP;
+            break;
+
+        default:
+            break;
+    }
+}
+
+void IrReceiver::frame(uint32_t code) {
+
+    // millis of the board, not of Clock, as the time source may not be called from interrupts
+    unsigned long ms = millis();
+    unsigned long us = micros();
+
+    if (code == 0xFFFFFFFF) {
+
+        // repeats of a lost frame or of a released key are ignored
+        if (_key == 0) return;
+
+        _last_ms = ms;
+        _last_us = us;
+
+        if (!_held && ms - _press_ms >= LONG_HOLD_TIME_MS) {
+            _held = true;
+            push(_key, ms, IR_KEY_HOLD);
+        }
+        return;
+    }
+
+    // a new frame may come sooner than the release of the previous key
+    release();
+
+    _key = code;
+    _press_ms = _last_ms = ms;
+    _last_us = us;
+    _held = false;
+    push(code, ms, IR_KEY_PRESS);
+}
+
+void IrReceiver::release() {
+
+    if (_key == 0) return;
+
+    push(_key, _last_ms, IR_KEY_RELEASE);
+    _key = 0;
+}
+
+void IrReceiver::push(uint32_t key, unsigned long ms, event_type_t type) {
+
+    if ((uint8_t)(_head - _tail) >= IR_EVENTS_SIZE) return;
+
+    event_t& event = _events[_head & (IR_EVENTS_SIZE - 1)];
+    event.key = key;
+    event.ms = ms;
+    event.type = type;
+
+    // the event is visible to pop() once the head moves
+    _head = _head + 1;
+}
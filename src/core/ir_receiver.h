@@ -0,0 +1,85 @@
+#ifndef IR_RECEIVER_H
+#define IR_RECEIVER_H
+
+#include "../config.h"
+#include "../hal/hal.h"
+
+#define IR_EVENTS_SIZE      8       // events waiting for Keypad (a power of two)
+#define IR_RELEASE_MS       120     // a key is released when no repeat frame comes for this long
+
+static_assert((IR_EVENTS_SIZE & (IR_EVENTS_SIZE - 1)) == 0, "IR event queue size must be a power of two!");
+
+// Decoder of NEC remote controls. The receiver pin is sampled by the step timer interrupt (pin 7
+// of the Mega has no pin change interrupt), edges are timestamped by micros(), so a late or lost
+// tick does not stretch a pulse, frames are decoded from the lengths of pulses right there and
+// turned into key events with millis of the frame ends:
+//
+//   IR_KEY_PRESS     the frame of a key (or of a new key)
+//   IR_KEY_HOLD      a repeat frame came LONG_HOLD_TIME_MS after the press (once per press)
+//   IR_KEY_RELEASE   no repeat frame for IR_RELEASE_MS, the time is of the last frame of the key
+//
+// The interrupt is the only writer and Keypad the only reader of the queue, full queue drops
+// new events. Unlike IRremote, no timer of its own runs and nothing is decoded in loop().
+class IrReceiver {
+
+    public:
+
+        enum event_type_t : uint8_t { IR_KEY_PRESS, IR_KEY_HOLD, IR_KEY_RELEASE };
+
+        struct event_t {
+            uint32_t key;
+            unsigned long ms;
+            event_type_t type;
+        };
+
+        static void initialize() {
+            hal::ir_begin();
+        }
+
+        // called by the step timer interrupt every tick, a few cycles unless a pulse ends or a key
+        // is held (then micros() is read for its release)
+        static inline void sample() {
+
+            if (_key && micros() - _last_us >= IR_RELEASE_MS * 1000UL) release();
+
+            bool mark = hal::ir_mark();
+            if (mark == _mark) return;
+
+            unsigned long us = micros();
+            edge(_mark, us - _edge_us);
+            _mark = mark;
+            _edge_us = us;
+        }
+
+        // takes the oldest event, returns false if there is none
+        static bool pop(event_t& event);
+
+    private:
+
+        enum state_t : uint8_t { IDLE, LEADER, BITS, STOP, REPEAT };
+
+        // a pulse ('mark') or a space of 'us' microseconds ended
+        static void edge(bool mark, unsigned long us);
+
+        static void frame(uint32_t code);
+        static void release();
+        static void push(uint32_t key, unsigned long ms, event_type_t type);
+
+        static event_t _events[IR_EVENTS_SIZE];
+        static volatile uint8_t _head;      // moved by the interrupt only
+        static volatile uint8_t _tail;      // moved by pop() only
+
+        static bool _mark;                  // the last sampled level
+        static unsigned long _edge_us;      // micros of the last edge
+        static state_t _state;
+        static uint8_t _bits;               // bits of the frame received so far
+        static uint32_t _code;
+
+        static uint32_t _key;               // the held key (0 for none)
+        static unsigned long _press_ms;     // end of the frame of the held key
+        static unsigned long _last_ms;      // end of the last frame of the held key
+        static unsigned long _last_us;      // micros of the end of the last frame of the held key
+        static bool _held;                  // IR_KEY_HOLD was sent for the held key
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef KEEP_OUT_H
+#define KEEP_OUT_H
+
+#include "../hal/hal.h"
+
+#include "../config.h"
+#include "angle.h"
+
+#define KEEP_OUT_ROWS   (180 / KEEP_OUT_CELL_DEG)   // local DEC -90..90
+#define KEEP_OUT_COLS   (360 / KEEP_OUT_CELL_DEG)   // local RA 0..360
+#define KEEP_OUT_BYTES  ((KEEP_OUT_ROWS * KEEP_OUT_COLS + 7) / 8)
+
+// Map of directions the mount must never point at (horizon, pier, tripod legs, ...) given in 
+// the local coordinates of the mount, it has a single bit for each cell of KEEP_OUT_CELL_DEG 
+// degrees, i.e. 324 bytes for 5 degree cells, so a lookup is just a multiplication and a shift. 
+// Row 0 starts at DEC -90 and column 0 at RA 0.
+class KeepOutMap {
+
+    public:
+
+        KeepOutMap() { clear(); }
+
+        // allows all directions
+        void clear() { memset(_bits, 0, KEEP_OUT_BYTES); }
+
+        // true if the cell containing the direction with local DEC 'dec' (a signed binary angle
+        // in -90..90) and local RA 'ra' is forbidden
+        inline boolean is_blocked(int32_t dec, bam_t ra) {
+
+            // DEC + 90 is in 0..2^31, RA in 0..2^32, 16 bit precision is more than enough
+            uint16_t row = ((uint32_t)(dec + (1L << 30)) >> 16) * KEEP_OUT_ROWS >> 15;
+            uint16_t col = (ra >> 16) * KEEP_OUT_COLS >> 16;
+            if (row >= KEEP_OUT_ROWS) row = KEEP_OUT_ROWS - 1;
+
+            return is_cell_blocked(row, col);
+        }
+
+        inline boolean is_cell_blocked(uint8_t row, uint8_t col) {
+            uint16_t i = row * KEEP_OUT_COLS + col;
+            return _bits[i >> 3] & (1 << (i & 7));
+        }
+
+        inline void set_cell_blocked(uint8_t row, uint8_t col, boolean blocked) {
+            uint16_t i = row * KEEP_OUT_COLS + col;
+            if (blocked) _bits[i >> 3] |= (1 << (i & 7));
+            else _bits[i >> 3] &= ~(1 << (i & 7));
+        }
+
+        // raw bitmap to be saved to (or loaded from) EEPROM
+        uint8_t* data() { return _bits; }
+
+    private:
+
+        uint8_t _bits[KEEP_OUT_BYTES];
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "log.h"
+
+Log::ring_t Log::_isr_ring = {};
+Log::ring_t Log::_main_ring = {};
+volatile uint8_t Log::_isr_depth = 0;
+
+void Log::push(ring_t& ring, const uint8_t* record, uint8_t length) {
+
+    if ((uint8_t)(ring.head - ring.tail) + length > LOG_BUFFER_SIZE) {
+        ++ring.dropped;
+        return;
+    }
+
+    for (uint8_t i = 0; i < length; ++i) ring.data[(uint8_t)(ring.head + i) & (LOG_BUFFER_SIZE - 1)] = record[i];
+
+    // the record is visible to drain() once the head moves
+    ring.head += length;
+}
+
+uint8_t Log::peek(ring_t& ring, uint16_t& ms) {
+
+    if (ring.head == ring.tail) return 0;
+
+    uint8_t tail = ring.tail;
+    ms = ring.data[(uint8_t)(tail + 3) & (LOG_BUFFER_SIZE - 1)] | ring.data[(uint8_t)(tail + 4) & (LOG_BUFFER_SIZE - 1)] << 8;
+    return LOG_HEADER_SIZE + ring.data[(uint8_t)(tail + 2) & (LOG_BUFFER_SIZE - 1)];
+}
+
+void Log::drain(HardwareSerial& serial) {
+
+    ring_t* rings[] = { &_isr_ring, &_main_ring };
+
+    for (ring_t* ring : rings) {
+
+        uint8_t dropped = ring->dropped - ring->reported;
+        if (dropped == 0 || serial.availableForWrite() < LOG_HEADER_SIZE + 4) continue;
+
+        uint16_t ms = millis();
+        uint8_t record[] = { LOG_SYNC, LOG_DROPPED, 4, (uint8_t)(ms & 0xFF), (uint8_t)(ms >> 8), dropped, 0, 0, 0 };
+        serial.write(record, sizeof(record));
+        ring->reported += dropped;
+    }
+
+    while (true) {
+
+        uint16_t isr_ms, main_ms;
+        uint8_t isr_length = peek(_isr_ring, isr_ms);
+        uint8_t main_length = peek(_main_ring, main_ms);
+        if (isr_length == 0 && main_length == 0) return;
+
+        // the older record goes first (millis are compared modulo 2^16)
+        bool from_isr = isr_length > 0 && (main_length == 0 || (int16_t)(isr_ms - main_ms) <= 0);
+        ring_t& ring = from_isr ? _isr_ring : _main_ring;
+        uint8_t length = from_isr ? isr_length : main_length;
+
+        if (serial.availableForWrite() < length) return;
+
+        for (uint8_t i = 0; i < length; ++i) serial.write(ring.data[(uint8_t)(ring.tail + i) & (LOG_BUFFER_SIZE - 1)]);
+        ring.tail += length;
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <string.h>
+
+#include "../config.h"
+#include "../hal/hal.h"
+#include "log_events.h"
+
+#define LOG_SYNC            0xA5    // the first byte of a record
+#define LOG_HEADER_SIZE     5       // sync, event, length of arguments and 16 bits of millis
+#define LOG_STRING_MAX      12      // longer string arguments are truncated (8.3 file names fit)
+#define LOG_RECORD_MAX      32      // record with header, up to 6 numbers or a string and 3 numbers
+
+static_assert(LOG_BUFFER_SIZE >= LOG_RECORD_MAX && LOG_BUFFER_SIZE <= 128 &&
+              (LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0, "Log buffer must be a power of two between 32 and 128!");
+
+#define LOG_EVENT_ID(id, format) id,
+enum log_event_t : uint8_t { LOG_EVENTS(LOG_EVENT_ID) LOG_EVENTS_COUNT };
+#undef LOG_EVENT_ID
+
+// Binary log replacing Serial prints of DEBUG builds, which are slow and block when the serial
+// buffer is full. A record is an event id with its arguments (see core/log_events.h) written
+// into a ring buffer in a few microseconds, records are sent over serial by drain() from loop()
+// and turned into text by tools/log_decode.cpp:
+//
+//   LOG_SYNC | event | length of arguments | millis (16 bits, little endian) | arguments
+//
+// There is a ring for the step timer interrupt and one for the rest of the code, each of them
+// has a single writer and the single reader (drain), so no interrupts are disabled. Records
+// which do not fit are dropped and counted.
+class Log {
+
+    public:
+
+        template<class... Args>
+        static void write(log_event_t event, Args... args) {
+            uint8_t record[LOG_RECORD_MAX];
+            uint8_t length = LOG_HEADER_SIZE;
+            encode(record, length, args...);
+            uint16_t ms = millis();
+            record[0] = LOG_SYNC;
+            record[1] = event;
+            record[2] = length - LOG_HEADER_SIZE;
+            record[3] = ms & 0xFF;
+            record[4] = ms >> 8;
+            push(_isr_depth ? _isr_ring : _main_ring, record, length);
+        }
+
+        // records written between these calls go to the ring of the interrupt (the step timer
+        // interrupt may enable interrupts, so it is marked explicitly), the calls may nest, an
+        // interrupt coming inside restores the depth before it returns
+        static inline void isr_begin() { ++_isr_depth; }
+        static inline void isr_end() { --_isr_depth; }
+
+        // sends whole records (the oldest first) as long as they fit into the serial output
+        // buffer, so it never blocks, call from loop()
+        static void drain(HardwareSerial& serial);
+
+    private:
+
+        struct ring_t {
+            volatile uint8_t data[LOG_BUFFER_SIZE];
+            volatile uint8_t head;      // moved by the writer only (wraps at 256, not at the size)
+            volatile uint8_t tail;      // moved by drain() only
+            volatile uint8_t dropped;   // records which did not fit, counted by the writer
+            uint8_t reported;           // dropped records already reported by drain()
+        };
+
+        static void push(ring_t& ring, const uint8_t* record, uint8_t length);
+
+        // returns the number of bytes (0 if empty) and millis of the oldest record of the ring
+        static uint8_t peek(ring_t& ring, uint16_t& ms);
+
+        static inline void encode(uint8_t*, uint8_t&) {}
+
+        template<class T, class... Args>
+        static inline void encode(uint8_t* record, uint8_t& length, T value, Args... args) {
+            put(record, length, value);
+            encode(record, length, args...);
+        }
+
+        static inline void put_word(uint8_t* record, uint8_t& length, uint32_t value) {
+            if (length + 4 > LOG_RECORD_MAX) return;
+            for (uint8_t i = 0; i < 4; ++i) record[length++] = value >> (8 * i);
+        }
+
+        static inline void put(uint8_t* record, uint8_t& length, int value) { put_word(record, length, (int32_t)value); }
+        static inline void put(uint8_t* record, uint8_t& length, unsigned int value) { put_word(record, length, value); }
+        static inline void put(uint8_t* record, uint8_t& length, long value) { put_word(record, length, (int32_t)value); }
+        static inline void put(uint8_t* record, uint8_t& length, unsigned long value) { put_word(record, length, value); }
+        static inline void put(uint8_t* record, uint8_t& length, double value) { put(record, length, (float)value); }
+
+        static inline void put(uint8_t* record, uint8_t& length, float value) {
+            uint32_t bits;
+            memcpy(&bits, &value, 4);
+            put_word(record, length, bits);
+        }
+
+        static inline void put(uint8_t* record, uint8_t& length, const char* value) {
+            uint8_t size = strlen(value);
+            if (size > LOG_STRING_MAX) size = LOG_STRING_MAX;
+            if (length + 1 + size > LOG_RECORD_MAX) return;
+            record[length++] = size;
+            memcpy(record + length, value, size);
+            length += size;
+        }
+
+        static ring_t _isr_ring;
+        static ring_t _main_ring;
+        static volatile uint8_t _isr_depth;    // isr_begin calls without isr_end
+};
+
+// writes a record of the event LOG_<event> with the arguments
+#define LOG(event, ...) Log::write(LOG_##event, ##__VA_ARGS__)
+
+#endif
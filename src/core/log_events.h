@@ -0,0 +1,43 @@
+#ifndef LOG_EVENTS_H
+#define LOG_EVENTS_H
+
+// Events of the binary log (see core/log.h). The firmware writes just the id of an event and its
+// arguments, the format is used by the host decoder (tools/log_decode.cpp), so the texts are not
+// stored in the firmware at all. Formats take printf conversions, arguments are 4 bytes long
+// (%d, %u, %x integers and %f floats) except of %s, which is a string of up to LOG_STRING_MAX
+// characters. Append new events to the end, the id of an event is its position.
+#define LOG_EVENTS(E) \
+    E(LOG_DROPPED,              "%u records dropped, the log buffer was full") \
+    E(LOG_MOTORS_PINS,          "Stepper motors pins initialized, pinout %02x, port %02x") \
+    E(LOG_MOTORS_STOP,          "Stopping both motors, port %02x") \
+    E(LOG_SLEW_MEASURED,        "Measured fast turn, DEC %u steps in %u ms, RA %u steps in %u ms") \
+    E(LOG_TURN,                 "Initializing new movement, revs DEC %f, RA %f, microstepping %d") \
+    E(LOG_TURN_PINS,            "Setting DIR and MS pins, port %02x -> %02x") \
+    E(LOG_STEPS,                "Steps to be done %d, delay (us) %u, MCU ticks per pulse %f, tick fraction (1/65536) %u") \
+    E(LOG_PULSES,               "Pulses DEC %d, RA %d") \
+    E(LOG_MOUNT_INIT,           "Mount initialized") \
+    E(LOG_GLOBAL_ORIENTATION,   "Global orientation DEC %f, RA %f") \
+    E(LOG_LOCAL_ORIENTATION,    "Local orientation DEC %.7f, RA %.7f") \
+    E(LOG_ALIGNMENT,            "All star alignment of %u points") \
+    E(LOG_ALIGNMENT_POINT,      "  %.2f,%.2f -> %.2f,%.2f") \
+    E(LOG_ALIGNMENT_STEP,       "(%u) | Fitness: %.12f | RA: %.7f | DEC: %.7f | Off: %.7f") \
+    E(LOG_APPARENT_PLACE,       "Apparent place DEC %.5f -> %.5f, RA %.5f -> %.5f") \
+    E(LOG_APPARENT_MATRIX,      "Apparent place matrix updated, centuries since J2000: %.7f") \
+    E(LOG_GOTO,                 "Turning at high speed to DEC %f, RA %f by revs DEC %.7f, RA %.7f") \
+    E(LOG_SLEW_PLANNING,        "Slew planning (%u) | duration (ms): %f | change (ms): %f") \
+    E(LOG_SLEW_REFUSED,         "Slew refused, keep-out position at DEC %f, RA %f") \
+    E(LOG_TURN_BY,              "Turning at high speed by DEC %f, RA %f, revs DEC %.7f, RA %.7f") \
+    E(LOG_TRACKING,             "Tracking target DEC %f, RA %f") \
+    E(LOG_TRACKING_CORRECTION,  "Tracking correction until (ms) %u, revs DEC %.7f, RA %.7f") \
+    E(LOG_TRACKING_SEGMENT,     "Tracking segment at (ms) %u, speed (dps) DEC %.7f, RA %.7f") \
+    E(LOG_LST,                  "Local siderial time %.5f") \
+    E(LOG_RTC_MISSING,          "Cannot find DS3231") \
+    E(LOG_KEY,                  "Keypad change %x --> %x") \
+    E(LOG_KEEP_OUT_ROWS,        "Keep-out map rows loaded: %d") \
+    E(LOG_SD_FILE,              "SD card file %s, %u bytes") \
+    E(LOG_CATALOGUE_MISSING,    "Catalogue file not found!") \
+    E(LOG_OBJECT_MISSING,       "Object %d not found in the catalogue!") \
+    E(LOG_OUT_OF_BOUNDS,        "Weird things happened! Mount out of bounds at DEC %f, RA %f") \
+    E(LOG_KEY_EVENT,            "Key event %u (press 0, hold 1, release 2) of %x at (ms) %u")
+
+#endif
@@ -1,6 +1,5 @@
 #define FROM_LIB
 
-#include <Arduino.h>
 #include "motor_controller.h"
 
 void MotorController::initialize() {
@@ -8,60 +7,38 @@ void MotorController::initialize() {
     uint8_t pin_mask = (1 << STEP_PIN_DEC) | (1 << DIR_PIN_DEC) | (1 << MS_PIN_DEC) |
                        (1 << STEP_PIN_RA)  | (1 << DIR_PIN_RA)  | (1 << MS_PIN_RA);
 
-    MOTORS_DDR |= pin_mask;
-    MOTORS_PORT &= ~pin_mask;
+    hal::motors_output(pin_mask);
 
     #ifdef DEBUG
-        Serial.println(F("Stepper motors pins initialized:"));
-        Serial.print(F("  Pinout: ")); Serial.println(pin_mask, BIN);
-        Serial.print(F("  DDR:    ")); Serial.println(MOTORS_DDR, BIN);
-        Serial.print(F("  PORT:   ")); Serial.println(MOTORS_PORT, BIN);
+        LOG(MOTORS_PINS, pin_mask, hal::motors_read());
     #endif
 
-    // Timer/Counter Control Register: set Fast PWM mode
-    TCCR5A = 0x23 ; // || set mode 7 (Fast PWM) with
-    TCCR5B = 0x09 ; // || prescaler 1 (no prescaling)
+    hal::timer_start(TIMER_TOP);
 
-    // Output Compare Register: set interrupt frequency
-    OCR5A = TIMER_TOP - 1;
-    OCR5B = 0;
-      
-    // Timer/Counter Interrupt Mask Register: set interrupt TIMERx_COMPA_vect
-    TIMSK5 |= (1 << OCIE5A);
-
-    #ifdef DEBUG
-        Serial.println(F("TimerX initialized."));
-        Serial.print(F("  TCCRxA: ")); Serial.println(TCCR5A, BIN);
-        Serial.print(F("  TCCRxB: ")); Serial.println(TCCR5B, BIN);
-        Serial.print(F("  TIMSKx: ")); Serial.println(TIMSK5, BIN);
-    #endif
-
-    _commands = queue<command_t>(8);
+    _commands.clear();
 
     _dec_balance = 0;
     _ra_balance = 0;
+
+    for (uint8_t i = 0; i < SLEW_MODEL_KNOTS; ++i) {
+        _slew_model.dec[i] = 1.0f;
+        _slew_model.ra[i]  = 1.0f;
+    }
 }
 
 void MotorController::stop() {
 
-    #ifdef DEBUG
-        Serial.println(F("Stopping both motors:"));
-    #endif
-    
     cli();
     _dec.pulses_remaining = 0;
     _ra.pulses_remaining = 0;
+    _ticks_remaining = 0;
+    _slew.running = false;
     sei();
-
-    #ifdef DEBUG
-        Serial.print(F("  DEC: ")); Serial.println(_dec.pulses_remaining);
-        Serial.print(F("  RA:  ")); Serial.println(_ra.pulses_remaining);
-    #endif
       
-    MOTORS_PORT &= ~((1 << STEP_PIN_DEC) | (1 << STEP_PIN_RA)); // step pins to LOW
+    hal::motors_clear((1 << STEP_PIN_DEC) | (1 << STEP_PIN_RA)); // step pins to LOW
 
     #ifdef DEBUG
-        Serial.print(F("  PORT:   ")); Serial.println(MOTORS_PORT, BIN);
+        LOG(MOTORS_STOP, hal::motors_read());
     #endif
 
     _commands.clear();
@@ -75,9 +52,88 @@ float MotorController::estimate_fast_turn_time(float revs_dec, float revs_ra) {
     auto time_dec = estimate_motor_fast_turn_time(sd, ACCEL_STEPS_DEC, ACCEL_DELAY_DEC, FAST_DELAY_START_DEC, FAST_DELAY_END_DEC);
     auto time_ra  = estimate_motor_fast_turn_time(sr, ACCEL_STEPS_RA,  ACCEL_DELAY_RA,  FAST_DELAY_START_RA,  FAST_DELAY_END_RA);
 
+    uint8_t lower;
+    float weight;
+    time_dec *= get_slew_correction(_slew_model.dec, sd, lower, weight);
+    time_ra  *= get_slew_correction(_slew_model.ra,  sr, lower, weight);
+
     return max(time_dec, time_ra);
 } 
 
+bool MotorController::learn_slew_duration() {
+
+    if (!_slew.finished) return false;
+
+    cli();
+    slew_record_t slew = _slew;
+    _slew.finished = false;
+    sei();
+
+    // the motor which finished last also waited for the residual slow turn
+    if (slew.dec_ms >= slew.ra_ms) slew.dec_ms = slew.total_ms;
+    else slew.ra_ms = slew.total_ms;
+
+    #ifdef DEBUG
+        LOG(SLEW_MEASURED, slew.steps_dec, slew.dec_ms, slew.steps_ra, slew.ra_ms);
+    #endif
+
+    bool changed = false;
+
+    if (slew.steps_dec >= SLEW_MODEL_MIN_STEPS) {
+        auto estimate = estimate_motor_fast_turn_time(slew.steps_dec, ACCEL_STEPS_DEC, ACCEL_DELAY_DEC, FAST_DELAY_START_DEC, FAST_DELAY_END_DEC);
+        learn_slew_correction(_slew_model.dec, slew.steps_dec, slew.dec_ms, estimate);
+        changed = true;
+    }
+
+    if (slew.steps_ra >= SLEW_MODEL_MIN_STEPS) {
+        auto estimate = estimate_motor_fast_turn_time(slew.steps_ra, ACCEL_STEPS_RA, ACCEL_DELAY_RA, FAST_DELAY_START_RA, FAST_DELAY_END_RA);
+        learn_slew_correction(_slew_model.ra, slew.steps_ra, slew.ra_ms, estimate);
+        changed = true;
+    }
+
+    return changed;
+}
+
+void MotorController::set_slew_model(const slew_model_t& model) {
+    for (uint8_t i = 0; i < SLEW_MODEL_KNOTS; ++i) {
+        // NaN returns false for all comparisons
+        _slew_model.dec[i] = (model.dec[i] >= 0.25f && model.dec[i] <= 4.0f) ? model.dec[i] : 1.0f;
+        _slew_model.ra[i]  = (model.ra[i]  >= 0.25f && model.ra[i]  <= 4.0f) ? model.ra[i]  : 1.0f;
+    }
+}
+
+float MotorController::get_slew_correction(const float knots[], float steps, uint8_t& lower, float& weight) {
+
+    lower = 0;
+    weight = 0.0f;
+
+    float knot_steps = 16.0f;
+    if (steps <= knot_steps) return knots[0];
+
+    while (lower < SLEW_MODEL_KNOTS - 1 && steps > 4.0f * knot_steps) {
+        knot_steps *= 4.0f;
+        ++lower;
+    }
+
+    if (lower == SLEW_MODEL_KNOTS - 1) return knots[lower];
+
+    weight = (steps - knot_steps) / (3.0f * knot_steps);
+    return (1.0f - weight) * knots[lower] + weight * knots[lower + 1];
+}
+
+void MotorController::learn_slew_correction(float knots[], float steps, float measured_ms, float estimated_ms) {
+
+    if (estimated_ms <= 0.0f) return;
+
+    // a single step of least mean squares fit of the piecewise linear function
+    uint8_t lower;
+    float weight;
+    float error = measured_ms / estimated_ms - get_slew_correction(knots, steps, lower, weight);
+
+    knots[lower] += SLEW_MODEL_LEARNING_RATE * (1.0f - weight) * error;
+    if (weight > 0.0f) knots[lower + 1] += SLEW_MODEL_LEARNING_RATE * weight * error;
+}
+
 float MotorController::estimate_motor_fast_turn_time(float steps, int accel_each, int accel_amount, int delay_start, int delay_end) {
 
     float time = 0;
@@ -103,47 +159,91 @@ void MotorController::fast_turn(float revs_dec, float revs_ra, boolean queueing)
 void MotorController::slow_turn(float revs_dec, float revs_ra, float speed_dec, float speed_ra, boolean queueing) {
     // revolutions per second convert to delay in micros
     // there might be some overflows, but nobody cares ... (hopefully)
-    float delay_dec = 1000000.0 / (speed_dec * STEPS_PER_REV_DEC * MICROSTEPPING_MUL);
-    float delay_ra  = 1000000.0 / (speed_ra  * STEPS_PER_REV_RA  * MICROSTEPPING_MUL);
+    // motors with zero speed have nothing to do, so the delay does not matter
+    unsigned long delay_dec = speed_dec > 0 ? (unsigned long)(1000000.0f / (speed_dec * Dec::MICROSTEPS_PER_REV) + 0.5f) : 0;
+    unsigned long delay_ra  = speed_ra  > 0 ? (unsigned long)(1000000.0f / (speed_ra  * Ra::MICROSTEPS_PER_REV) + 0.5f) : 0;
     turn_internal({revs_dec, revs_ra, delay_dec, delay_ra, delay_dec, delay_ra, true}, queueing);
 }
 
-void MotorController::turn_internal(command_t cmd, bool queueing) {
+void MotorController::turn_internal(command_t cmd, bool queueing, bool continued) {
 
     if (queueing && !is_ready()) {
         _commands.push(cmd);
+        RuntimeStats::record_queue(_commands.count());
         return;
     }
 
     #ifdef DEBUG
-        Serial.println(F("Initializing new movement."));
-        Serial.print(F("  revs DEC:       ")); Serial.println(cmd.revs_dec);
-        Serial.print(F("  resv RA:        ")); Serial.println(cmd.revs_ra);
-        Serial.print(F("  micro s. (t/f): ")); Serial.println(cmd.microstepping ? "enabled" : "disabled");
-    #endif
-
-    #ifdef DEBUG
-        Serial.println(F("Setting DIR and MS pins:"));
-        Serial.print(F("  PORT:  ")); Serial.print(MOTORS_PORT, BIN);
+        LOG(TURN, cmd.revs_dec, cmd.revs_ra, cmd.microstepping);
+        uint8_t port = hal::motors_read();
     #endif
 
     cli();
 
-    // wait 1ms for pins to stabilize if needed
-    if (change_pin(DIR_PIN_DEC, (cmd.revs_dec > 0 && DIRECTION_DEC) || (cmd.revs_dec < 0 && !DIRECTION_DEC)) | 
-        change_pin(DIR_PIN_RA,  (cmd.revs_ra  > 0 && DIRECTION_RA)  || (cmd.revs_ra  < 0 && !DIRECTION_RA))  |
-        change_pin(MS_PIN_DEC, cmd.microstepping) |
-        change_pin(MS_PIN_RA,  cmd.microstepping)) delay(1);
+    float steps_dec, steps_ra;
+    revs_to_steps(steps_dec, steps_ra, cmd.revs_dec, cmd.revs_ra, cmd.microstepping);
+
+    // slow turns make the nearest number of microsteps, see below
+    uint32_t effective_steps_dec = cmd.microstepping ? steps_dec + 0.5f : steps_dec;
+    uint32_t effective_steps_ra = cmd.microstepping ? steps_ra + 0.5f : steps_ra;
+
+    // motors without steps keep their direction, so a DEC axis slowly turning back and forth
+    // does not change its pin every tracking movement
+    bool forward_dec = (cmd.revs_dec > 0 && DIRECTION_DEC) || (cmd.revs_dec < 0 && !DIRECTION_DEC);
+    bool forward_ra  = (cmd.revs_ra  > 0 && DIRECTION_RA)  || (cmd.revs_ra  < 0 && !DIRECTION_RA);
+    bool reversed_dec = effective_steps_dec > 0 && change_pin(DIR_PIN_DEC, forward_dec);
+    bool reversed_ra  = effective_steps_ra  > 0 && change_pin(DIR_PIN_RA,  forward_ra);
+    bool switched = change_pin(MS_PIN_DEC, cmd.microstepping) | change_pin(MS_PIN_RA,  cmd.microstepping);
+
+    // a slow turn right after another one in the same direction continues its steps, see below
+    continued = continued && cmd.microstepping && !switched;
+    bool continued_dec = continued && !reversed_dec;
+    bool continued_ra  = continued && !reversed_ra;
+
+    // wait 1ms for pins to stabilize if needed, but not in the interrupt between slow turns, the
+    // direction needs 200 ns before a step (A4988) and the wait would delay steps of the other motor
+    if (switched || ((reversed_dec || reversed_ra) && !continued)) delay(1);
 
     #ifdef DEBUG
-        Serial.print(F(" ---> ")); Serial.println(MOTORS_PORT, BIN);
+        LOG(TURN_PINS, port, hal::motors_read());
     #endif
 
-    float steps_dec, steps_ra;
-    revs_to_steps(steps_dec, steps_ra, cmd.revs_dec, cmd.revs_ra, cmd.microstepping);
+    // Slow turns keep their duration, it is counted by ticks, so a fraction of a microstep which
+    // is not made (or made in advance) does not change the end of tracking movements. Microsteps
+    // are made when the commanded motion passes their middle and the fraction is made by the next
+    // slow turn which continues this one (tracking computes revolutions from the target pulses),
+    // so the period of steps is given by the revolutions without the carried fraction and their
+    // first step comes by its phase, the rate does not jump by a whole step per movement (from
+    // 19 to 21 steps every second of sidereal tracking)
+    float remainder_dec = 0, remainder_ra = 0;
+    uint32_t late_ticks = 0;
+    if (cmd.microstepping) {
+        if (continued_dec) remainder_dec = _dec.steps_remainder;
+        if (continued_ra) remainder_ra = _ra.steps_remainder;
+        // movements are continued on time even if the last step of the previous one was late
+        if (continued && _ticks_remaining < 0) late_ticks = -_ticks_remaining;
+        _ticks_remaining = (continued ? _ticks_remaining : 0) + (long)(max(cmd.delay_start_dec * steps_dec, cmd.delay_start_ra * steps_ra) / TMR_RESOLUTION + 0.5f);
+        if (effective_steps_dec > 0) cmd.delay_start_dec = cmd.delay_end_dec = cmd.delay_start_dec * steps_dec / (steps_dec - remainder_dec);
+        if (effective_steps_ra > 0) cmd.delay_start_ra = cmd.delay_end_ra = cmd.delay_start_ra * steps_ra / (steps_ra - remainder_ra);
+        // the fraction is in the direction of the pin, a motor without steps may turn against it
+        _dec.steps_remainder = steps_dec - effective_steps_dec;
+        _ra.steps_remainder = steps_ra - effective_steps_ra;
+        if (((hal::motors_read() >> DIR_PIN_DEC) & 1) != forward_dec) _dec.steps_remainder = -_dec.steps_remainder;
+        if (((hal::motors_read() >> DIR_PIN_RA) & 1) != forward_ra) _ra.steps_remainder = -_ra.steps_remainder;
+    } else {
+        _ticks_remaining = 0;
+    }
 
-    uint32_t effective_steps_dec = steps_dec;
-    uint32_t effective_steps_ra = steps_ra;
+    // start measuring the duration of fast turns for the slew model
+    if (!cmd.microstepping) {
+        _slew.running = true;
+        _slew.finished = false;
+        _slew.steps_dec = effective_steps_dec;
+        _slew.steps_ra = effective_steps_ra;
+        _slew.start_ms = millis();
+        _slew.dec_ms = SLEW_NOT_FINISHED;
+        _slew.ra_ms = SLEW_NOT_FINISHED;
+    }
 
     _dec.pulses_to_accel = 0;
     _ra.pulses_to_accel  = 0;
@@ -157,24 +257,36 @@ void MotorController::turn_internal(command_t cmd, bool queueing) {
     _dec.start_steps_delay = cmd.delay_start_dec;
     _ra.start_steps_delay  = cmd.delay_start_ra;
 
+    _dec.short_pulses = cmd.microstepping;
+    _ra.short_pulses = cmd.microstepping;
+
     step_micros(_dec, effective_steps_dec * 2, _dec.start_steps_delay);
     step_micros(_ra,  effective_steps_ra  * 2, _ra.start_steps_delay);
 
-    // compensate coarse resolution of the full-step movement
+    // the first step is made when the motion passes the middle of the microstep
+    if (cmd.microstepping) {
+        _dec.ticks_passed = (0.5f + remainder_dec) * _dec.mcu_ticks_per_pulse + late_ticks;
+        _ra.ticks_passed = (0.5f + remainder_ra) * _ra.mcu_ticks_per_pulse + late_ticks;
+    }
+
+    // compensate coarse resolution of the full-step movement (steps are absolute, so the
+    // fraction turns in the direction of the movement)
     if (!cmd.microstepping) {
         float revs_dec, revs_ra;
         steps_to_revs(revs_dec, revs_ra, steps_dec - effective_steps_dec, steps_ra - effective_steps_ra, false);
+        if (cmd.revs_dec < 0) revs_dec = -revs_dec;
+        if (cmd.revs_ra < 0) revs_ra = -revs_ra;
         slow_turn(revs_dec, revs_ra, FAST_REVS_PER_SEC_DEC / MICROSTEPPING_MUL, FAST_REVS_PER_SEC_RA / MICROSTEPPING_MUL, true);
     }
 
-    TCNT1 = 0; // reset Timer1 counter
+    hal::timer_restart();
 
     sei();
 }
 
 bool MotorController::change_pin(byte pin, byte value) {
-    if (((MOTORS_PORT >> pin) & 1) == value) return false;
-    MOTORS_PORT ^= (-value ^ MOTORS_PORT) & (1 << pin);
+    if (((hal::motors_read() >> pin) & 1) == value) return false;
+    hal::motors_toggle((-value ^ hal::motors_read()) & (1 << pin));
     return true;
 }
 
@@ -182,41 +294,33 @@ void MotorController::step_micros(motor_data& data, long pulses, unsigned long m
 
     data.current_steps_delay = micros_between_steps;
 
-    #ifdef DEBUG
-        Serial.println(F("Steps to be done:"));
-        Serial.print(F("  ")); Serial.print(pulses / 2); Serial.print(F(", delay (us): ")); Serial.println(micros_between_steps);
-    #endif
-
     data.pulses_remaining = pulses;
 
-    float mcu_ticks_per_pulse = micros_between_steps / 2.0 / TMR_RESOLUTION;
-
-    #ifdef DEBUG
-        Serial.println(F("MCU ticks per one pulse:"));
-        Serial.print(F("  ")); Serial.println(mcu_ticks_per_pulse); 
-    #endif
+    float mcu_ticks_per_pulse = micros_between_steps / (data.short_pulses ? 1.0 : 2.0) / TMR_RESOLUTION;
 
     data.mcu_ticks_per_pulse = mcu_ticks_per_pulse;
 
-    data.pulses_to_correct = 0;
-    float err = mcu_ticks_per_pulse - data.mcu_ticks_per_pulse;
-    if (err == 0.0) data.pulses_to_correct = 0;
-    else data.pulses_to_correct = 1.0 / err;
+    // the fraction of a tick is accumulated by pulses and a pulse waits a tick more whenever
+    // the sum overflows, so the mean period is exact (a period of corrections rounded to whole
+    // pulses made slow turns up to 0.1 % longer), the sum starts at a half to round the duration
+    data.tick_fraction = (mcu_ticks_per_pulse - data.mcu_ticks_per_pulse) * 65536.0f;
 
     #ifdef DEBUG
-        Serial.println(F("Number of pulses after which is added an empty tick:"));
-        Serial.print(F("  ")); Serial.println(data.pulses_to_correct); 
+        LOG(STEPS, pulses / 2, micros_between_steps, mcu_ticks_per_pulse, (unsigned int)data.tick_fraction);
     #endif
 
     data.ticks_passed = 0;
-    data.pulses_until_correction = 0;
+    data.fraction_sum = 0x8000;
     data.correction = false;
 }
 
 void MotorController::trigger() {
 
-    if (_ra.pulses_remaining == 0 && _dec.pulses_remaining == 0 && _commands.count() > 0) {
-        turn_internal(_commands.pop(), false);
+    // counts below zero while the last step of a slow turn is late
+    if (_ticks_remaining > 0 || _dec.pulses_remaining > 0 || _ra.pulses_remaining > 0) --_ticks_remaining;
+
+    if (is_ready() && _commands.count() > 0) {
+        turn_internal(_commands.pop(), false, true);
     }
 
     // DEC motor pulse should be done
@@ -225,6 +329,8 @@ void MotorController::trigger() {
     // RA motor pulse should be done
     _ra_balance += motor_trigger(_ra, STEP_PIN_RA, DIR_PIN_RA, DIRECTION_RA, MS_PIN_RA);
 
+    if (_slew.running) record_slew();
+
     // these calls will take some time so we will probaly miss some next 
     // interrupts but we do not really care because we are changing speed
     // and this does not happen during tracking so everything should be ok
@@ -232,6 +338,21 @@ void MotorController::trigger() {
     change_motor_speed(_ra, ACCEL_STEPS_RA * 2, ACCEL_DELAY_RA);
 }
 
+void MotorController::record_slew() {
+
+    unsigned long elapsed = millis() - _slew.start_ms;
+
+    if (_slew.dec_ms == SLEW_NOT_FINISHED && _dec.pulses_remaining == 0) _slew.dec_ms = elapsed;
+    if (_slew.ra_ms  == SLEW_NOT_FINISHED && _ra.pulses_remaining  == 0) _slew.ra_ms  = elapsed;
+
+    // the residual slow turn is still queued or running
+    if (!is_ready() || _commands.count() > 0) return;
+
+    _slew.total_ms = elapsed;
+    _slew.running = false;
+    _slew.finished = true;
+}
+
 void MotorController::change_motor_speed(motor_data& data, int change_pulses, int amount) {
 
     bool accel_desired = false;
@@ -261,20 +382,28 @@ void MotorController::change_motor_speed(motor_data& data, int change_pulses, in
 int MotorController::motor_trigger(motor_data& data, byte pin, byte dir, bool dir_swap, byte ms) {
 
     if (data.pulses_remaining == 0) return 0;
-    if (!data.correction) ++data.ticks_passed;
+    ++data.ticks_passed;
+
+    // a step of slow turns is a pulse of a single tick, so the period is between rising edges
+    if (!data.short_pulses || !((hal::motors_read() >> pin) & 1)) {
 
-    if (data.ticks_passed < data.mcu_ticks_per_pulse) return 0;
+        if (data.ticks_passed < data.mcu_ticks_per_pulse) return 0;
 
-    if (data.pulses_to_correct != 0 && ++data.pulses_until_correction == data.pulses_to_correct) {
-        data.pulses_until_correction = 0;
-        data.correction = true;
+        // the correction is a single empty tick before the pulse whose fraction overflows, so the
+        // last pulse of a movement is not corrected after its end
+        if (!data.correction) {
+            uint16_t fraction_sum = data.fraction_sum + data.tick_fraction;
+            data.correction = fraction_sum < data.fraction_sum;
+            data.fraction_sum = fraction_sum;
+            if (data.correction) return 0;
+        }
+        data.correction = false;
+        data.ticks_passed = 0;
     }
-    else data.correction = false;
 
     ++data.pulses_to_accel;
     --data.pulses_remaining;
-    data.ticks_passed = 0;
-    MOTORS_PORT ^= (1 << pin);
+    hal::motors_toggle(1 << pin);
 
-    return (MOTORS_PORT & (1 << ms) ? 1 : MICROSTEPPING_MUL) * (((MOTORS_PORT >> dir) & 1) != dir_swap ? -1 : 1);
+    return pulse_balance(dir, dir_swap, ms);
 }
\ No newline at end of file
@@ -2,16 +2,35 @@
 #define MOTORCONTROLLER_H
 
 #include "../config.h"
+#include "../hal/hal.h"
+#include "axis.h"
 #include "queue.h"
+#include "runtime_stats.h"
+#include "log.h"
+#include "ir_receiver.h"
 
 #define TMR_RESOLUTION  64
 #define TIMER_TOP (F_CPU / (1000000.0 / TMR_RESOLUTION))
 
+#define SLEW_NOT_FINISHED   0xFFFFFFFF
+
 class MountController;
 class MotorController {
     
     public:
 
+        // unit conversions of motors and gears of both axes (see core/axis.h)
+        using Dec = DecAxis;
+        using Ra = RaAxis;
+
+        // Correction of the theoretical fast turn duration learned from measured slews, it is 
+        // a piecewise linear function of full steps (ratio of measured and theoretical duration)
+        // with knots at 16 * 4^i steps, one for each motor
+        struct slew_model_t {
+            float dec[SLEW_MODEL_KNOTS];
+            float ra[SLEW_MODEL_KNOTS];
+        };
+
         // singleton class
         MotorController(MotorController const&) = delete;
         void operator=(MotorController const&)  = delete;
@@ -24,13 +43,33 @@ class MotorController {
         void initialize();
 
         // returns true if motors have absolutely no job
-        inline bool is_ready() { return _dec.pulses_remaining == 0 && _ra.pulses_remaining == 0; }
+        inline bool is_ready() { return _dec.pulses_remaining == 0 && _ra.pulses_remaining == 0 && _ticks_remaining <= 0; }
+
+        // returns the time (millis) until the end of the running slow turn, which lasts as long
+        // as commanded even if its last pulses are made earlier (0 for fast turns)
+        unsigned long get_remaining_ms() {
+            cli();
+            long ticks = _ticks_remaining;
+            sei();
+            return ticks > 0 ? (uint64_t)ticks * TMR_RESOLUTION / 1000 : 0;
+        }
+
+        // returns number of commands waiting in the queue (the running one is not included)
+        inline int queued_commands() { return _commands.count(); }
 
         // interrupts all motor movements and clear command queue
         void stop();
 
-        // estimates time (millis) of the complete fast_turn duration
+        // estimates time (millis) of the complete fast_turn duration (corrected by the slew model)
         float estimate_fast_turn_time(float revs_dec, float revs_ra);
+
+        // refines the slew model by the last finished fast turn, returns true if it was changed
+        bool learn_slew_duration();
+
+        inline const slew_model_t& get_slew_model() { return _slew_model; }
+
+        // sets a (saved) slew model, invalid knots are reset to no correction
+        void set_slew_model(const slew_model_t& model);
         
         // make a fast turn with subsequent slow turn for compensate the coarse resolution of full step
         void fast_turn(float revs_dec, float revs_ra, boolean queueing);
@@ -43,24 +82,42 @@ class MotorController {
 
         // returns the number of revolutions relative to the starting position
         void get_made_revolutions(float& dec, float& ra) {
+            Dec::pulses_t dec_pulses;
+            Ra::pulses_t ra_pulses;
+            get_made_pulses(dec_pulses, ra_pulses);
+            dec = Dec::pulses_to_revs(dec_pulses);
+            ra = Ra::pulses_to_revs(ra_pulses);
+        }
+
+        // returns the number of pulses relative to the starting position once the running
+        // movement is finished (queued commands are not taken into account)
+        void get_target_pulses(Dec::pulses_t& dec, Ra::pulses_t& ra) {
+            cli();
+            dec = Dec::pulses_t(_dec_balance + (long)_dec.pulses_remaining * pulse_balance(DIR_PIN_DEC, DIRECTION_DEC, MS_PIN_DEC));
+            ra = Ra::pulses_t(_ra_balance + (long)_ra.pulses_remaining * pulse_balance(DIR_PIN_RA, DIRECTION_RA, MS_PIN_RA));
+            sei();
+        }
+
+        // returns the number of pulses (two per microstep) relative to the starting position
+        void get_made_pulses(Dec::pulses_t& dec, Ra::pulses_t& ra) {
+            cli();
+            dec = Dec::pulses_t(_dec_balance);
+            ra = Ra::pulses_t(_ra_balance);
+            sei();
             #ifdef DEBUG
-                Serial.println(F("Revolutions"));
-                Serial.print(F(" DEC: ")); Serial.println(_dec_balance); 
-                Serial.print(F("  RA: ")); Serial.println(_ra_balance); 
+                LOG(PULSES, dec.value, ra.value);
             #endif
-            dec = (float) _dec_balance / 2.0f / STEPS_PER_REV_DEC / MICROSTEPPING_MUL;
-            ra = (float) _ra_balance / 2.0f / STEPS_PER_REV_RA / MICROSTEPPING_MUL;
         }
 
     private:
-        MotorController() {}
+        MotorController() : _commands(8) {}
 
         // structure holding state of motors and movement while executing a command
         struct motor_data {
             volatile uint32_t steps_total = 0;  // steps to be done during this particular movement
             volatile uint32_t pulses_remaining = 0;  // pulses to be done until the end of this movement
-            volatile uint32_t pulses_until_correction = 0;  // pulses to be done until inserting an extra pulse
-            volatile uint32_t pulses_to_correct = 0;  // number of pulses after which is done a correction
+            volatile uint16_t tick_fraction = 0;  // fraction of a tick (1/65536) of every pulse over mcu_ticks_per_pulse
+            volatile uint16_t fraction_sum = 0;  // fractions of ticks accumulated by pulses, an overflow is a correction
             volatile uint32_t mcu_ticks_per_pulse = 0;  // number of ticks after which is done a pulse
             volatile uint32_t pulses_to_accel = 0;  // number of pulses after which is done an ac/deceleration
             volatile uint32_t start_steps_delay = 0;  // delay between steps at the start of fast movement
@@ -68,6 +125,8 @@ class MotorController {
             volatile uint32_t current_steps_delay = 0;  // current delay between steps
             volatile uint32_t ticks_passed = 0;  // counter of ticks for triggering pulse (see mcu_ticks_per_pulse)
             volatile bool correction = false;  // flag to state whether do or do not do correction 
+            volatile bool short_pulses = false;  // steps are pulses of a tick, mcu_ticks_per_pulse is their period
+            float steps_remainder = 0;  // fraction of a microstep which the last slow turn did not make (-0.5 to 0.5)
         };
 
         // structre holding a command for motors
@@ -81,11 +140,36 @@ class MotorController {
             bool microstepping;  // whether enable microstepping
         };
 
+        // structure holding measurement of a fast turn, durations are set by the interrupt service
+        // rutine once a motor finishes its movement (the one finishing last waits for the residual
+        // slow turn, which is measured by 'total_ms')
+        struct slew_record_t {
+            volatile bool running = false;
+            volatile bool finished = false;
+            uint32_t steps_dec = 0;
+            uint32_t steps_ra = 0;
+            unsigned long start_ms = 0;
+            volatile unsigned long dec_ms = 0;
+            volatile unsigned long ra_ms = 0;
+            volatile unsigned long total_ms = 0;
+        };
+
         // estimates time (millis) of the complete fast_turn duration of a single motor
         float estimate_motor_fast_turn_time(float steps, int accel_each, int accel_amount, int dalay_start, int dalay_end);
 
-        // make a turn of specified angles, speed (starting, ending) and command queueing
-        void turn_internal(command_t cmd, bool queueing);
+        // returns the correction of theoretical duration of a fast turn with 'steps' full steps,
+        // 'lower' is set to the index of the knot on the left and 'weight' to the weight of the right one
+        float get_slew_correction(const float knots[], float steps, uint8_t& lower, float& weight);
+
+        // moves the knots of 'knots' towards the ratio of measured and estimated duration
+        void learn_slew_correction(float knots[], float steps, float measured_ms, float estimated_ms);
+
+        // records finishing times of motors during a fast turn, called from the interrupt service rutine
+        inline void record_slew();
+
+        // make a turn of specified angles, speed (starting, ending) and command queueing, 'continued'
+        // if it follows the running movement right away (see the phase of slow turns)
+        void turn_internal(command_t cmd, bool queueing, bool continued = false);
 
         // set job to move specified number of steps with delays between them
         void step_micros(motor_data& data, long steps, unsigned long micros_between_steps);
@@ -99,14 +183,20 @@ class MotorController {
         // returns true if 'value' is defferent from current value (1 or 0) and changes pin appropriately 
         inline bool change_pin(byte pin, byte value);
 
+        // returns change of balance caused by a single pulse with current DIR and MS pins 
+        inline int pulse_balance(byte dir, bool dir_swap, byte ms) {
+            uint8_t port = hal::motors_read();
+            return (port & (1 << ms) ? 1 : MICROSTEPPING_MUL) * (((port >> dir) & 1) != dir_swap ? -1 : 1);
+        }
+
         inline void revs_to_steps(float &steps_dec, float &steps_ra, float revs_dec, float revs_ra, bool microstepping) {
-            steps_dec = abs(revs_dec) * STEPS_PER_REV_DEC * (microstepping ? MICROSTEPPING_MUL : 1);
-            steps_ra  = abs(revs_ra)  * STEPS_PER_REV_RA  * (microstepping ? MICROSTEPPING_MUL : 1);
+            steps_dec = Dec::revs_to_steps(Dec::revs_t(revs_dec), microstepping);
+            steps_ra  = Ra::revs_to_steps(Ra::revs_t(revs_ra), microstepping);
         }
 
         inline void steps_to_revs(float &revs_dec, float &revs_ra, float steps_dec, float steps_ra, bool microstepping) {
-            revs_dec = steps_dec / STEPS_PER_REV_DEC / (microstepping ? MICROSTEPPING_MUL : 1);
-            revs_ra  = steps_ra  / STEPS_PER_REV_RA  / (microstepping ? MICROSTEPPING_MUL : 1);
+            revs_dec = Dec::steps_to_revs(steps_dec, microstepping);
+            revs_ra  = Ra::steps_to_revs(steps_ra, microstepping);
         }
 
         // some motor state variables
@@ -114,12 +204,27 @@ class MotorController {
         motor_data _ra;
         queue<command_t> _commands;
 
-        long _dec_balance;
-        long _ra_balance;
+        slew_record_t _slew;
+        slew_model_t _slew_model;
+
+        volatile long _dec_balance;
+        volatile long _ra_balance;
+
+        volatile long _ticks_remaining = 0;  // ticks until the end of the running slow turn (below zero if late)
 };
 
 #ifndef FROM_LIB
-ISR(TIMER5_COMPA_vect) { MotorController::instance().trigger(); }
+HAL_TIMER_ISR { 
+    uint16_t latency = hal::timer_count();
+    uint16_t start = hal::cycle_counter();
+    Log::isr_begin();
+    // step pulses go first, edges of the IR signal are timestamped by micros(), so the time
+    // spent before sampling does not matter
+    MotorController::instance().trigger(); 
+    IrReceiver::sample();
+    Log::isr_end();
+    RuntimeStats::record_isr(latency, (hal::cycle_counter() - start) & HAL_CYCLE_MASK, TIMER_TOP);
+}
 #endif
 
 #endif
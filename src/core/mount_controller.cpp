@@ -1,6 +1,5 @@
 #define FROM_LIB
 
-#include <Arduino.h>
 #include <float.h>
 
 #include "mount_controller.h"
@@ -9,33 +8,33 @@ void MountController::initialize() {
 
     _motors.initialize();
 
-    #ifdef DEBUG_MOUNT
-        Serial.println(F("Stepper motors initialized."));
-    #endif
-
     _is_tracking = false;
+    _apparent_valid = false;
+    _zenith = polar_to_cartesian({LATITUDE, 180});
     
     _mount_orientation = {0, 0};
     set_mount_pole(coord_t {DEFAULT_POLE_DEC, DEFAULT_POLE_RA}, DEFUALT_RA_OFFSET);
 
     #ifdef DEBUG_MOUNT
-        Serial.println(F("Mount initialized."));
+        LOG(MOUNT_INIT);
     #endif
 }
 
+void MountController::update() {
+    if (_is_tracking) update_tracking();
+}
+
 MountController::coord_t MountController::get_global_mount_orientation() {
 
     coord_t local = get_local_mount_orientation();
-    coord_t global = polar_to_polar(local, _transition_inverse);
+    coord_t global = to_global(local);
 
     // see _mount_pole comments in header file for the explanation of 180-...
     global.ra = to_time_global_ra(global.ra);
     if (global.ra < 0) global.ra += 360;
 
     #ifdef DEBUG_MOUNT
-        Serial.println(F("Global orientation:"));
-        Serial.print(F("  DEC:  ")); Serial.println(global.dec);
-        Serial.print(F("  RA:   ")); Serial.println(global.ra);
+        LOG(GLOBAL_ORIENTATION, global.dec, global.ra);
     #endif
 
     return global;
@@ -43,21 +42,17 @@ MountController::coord_t MountController::get_global_mount_orientation() {
 
 MountController::coord_t MountController::get_local_mount_orientation() {
 
-    float dec_revs_done, ra_revs_done;
-    _motors.get_made_revolutions(dec_revs_done, ra_revs_done);
-
-    _mount_orientation = revolutions_to_angle({dec_revs_done, ra_revs_done});
+    position_t position = get_local_mount_position();
+    _mount_orientation = { bam64_to_deg(position.dec), bam64_to_deg(position.ra) };
 
     // DEC and RA must be in bounds and this should never happen! exception would be wonderful 
-    if (_mount_orientation.dec > 90.0f || _mount_orientation.dec < -90.0f ||
-        _mount_orientation.ra > 360.0f || _mount_orientation.ra < 0.0f){
-        Serial.println(F("Weird things happed! DEC out of bounds!"));
+    if (_mount_orientation.dec > DEC_LIMIT_MAX || _mount_orientation.dec < DEC_LIMIT_MIN ||
+        _mount_orientation.ra > RA_LIMIT_MAX || _mount_orientation.ra < RA_LIMIT_MIN){
+        LOG(OUT_OF_BOUNDS, _mount_orientation.dec, _mount_orientation.ra);
     }   
    
     #ifdef DEBUG_MOUNT
-        Serial.println(F("Local orientation:"));
-        Serial.print(F("  DEC:  ")); Serial.println(_mount_orientation.dec, 7);
-        Serial.print(F("  RA:   ")); Serial.println(_mount_orientation.ra, 7);
+        LOG(LOCAL_ORIENTATION, _mount_orientation.dec, _mount_orientation.ra);
     #endif
 
     return _mount_orientation;
@@ -70,19 +65,8 @@ void MountController::all_star_alignment(coord_t kernel[], coord_t image[], uint
     // TODO: better analytical solution
 
     #ifdef DEBUG_MOUNT
-        Serial.println(F("All start alignment:"));
-        Serial.print(F("# input points: "));
-        Serial.println(points_num);
-        for (int i = 0; i < points_num; ++i) {
-            Serial.print(F("  "));
-            Serial.print(kernel[i].ra, 2);
-            Serial.print(F(","));
-            Serial.print(kernel[i].dec, 2);
-            Serial.print(F(" -> "));
-            Serial.print(image[i].ra, 2);
-            Serial.print(F(","));
-            Serial.println(image[i].dec, 2);
-        }
+        LOG(ALIGNMENT, points_num);
+        for (int i = 0; i < points_num; ++i) LOG(ALIGNMENT_POINT, kernel[i].ra, kernel[i].dec, image[i].ra, image[i].dec);
     #endif
 
     static const long rnd_max = 1000000;
@@ -90,8 +74,9 @@ void MountController::all_star_alignment(coord_t kernel[], coord_t image[], uint
     cartesian_t x[CAL_BUFFER_SIZE];
     cartesian_t y[CAL_BUFFER_SIZE];
 
+    // kernel points are true positions, but the mount sees them refracted
     for (int i = 0; i < points_num; ++i) {
-        x[i] = polar_to_cartesian(kernel[i]);
+        x[i] = refract(polar_to_cartesian(kernel[i]), false);
         y[i] = polar_to_cartesian(image[i]);
     }
 
@@ -119,9 +104,9 @@ void MountController::all_star_alignment(coord_t kernel[], coord_t image[], uint
             float objective = 0;
             for (uint8_t i = 0; i < points_num; ++i) {           
                 cartesian_t p = A * x[i];
-                float d_x = (p.x - y[i].x);
-                float d_y = (p.y - y[i].y); 
-                float d_z = (p.z - y[i].z); 
+                float d_x = (float)(p.x - y[i].x);
+                float d_y = (float)(p.y - y[i].y); 
+                float d_z = (float)(p.z - y[i].z); 
                 objective += d_x * d_x + d_y * d_y + d_z * d_z;
             }
 
@@ -140,13 +125,7 @@ void MountController::all_star_alignment(coord_t kernel[], coord_t image[], uint
         solution[2] = best_offspring[2];
         
         #ifdef DEBUG_MOUNT
-            if (s % 25 == 0) {
-                Serial.print(F("("));  Serial.print(s);
-                Serial.print(F(") | Fitness: "));    Serial.print(best_fitness, 12);
-                Serial.print(F(" | RA: "));     Serial.print(solution[0], 7);
-                Serial.print(F(" | DEC: "));    Serial.print(solution[1], 7);
-                Serial.print(F(" | Off: "));    Serial.println(solution[2], 7);
-            }
+            if (s % 25 == 0) LOG(ALIGNMENT_STEP, s, best_fitness, solution[0], solution[1], solution[2]);
         #endif
 
         if (best_fitness > OPT_PRECISION) break;
@@ -163,97 +142,266 @@ void MountController::all_star_alignment(coord_t kernel[], coord_t image[], uint
     set_mount_pole(coord_t {solution[1], solution[0]}, solution[2]);
 }
 
-void MountController::move_absolute_J2000(deg_t angle_dec, deg_t angle_ra) {
-
-    // Equations from Astrophysical Fomulae: Volume II page 18
-    // accuracy of few arc seconds
-    // it could be worth it to use an exact precession matrix like Stellarium does 
+bool MountController::move_absolute_J2000(deg_t angle_dec, deg_t angle_ra) {
 
-    if (angle_dec < -90 || angle_dec > 90 || angle_ra < 0 || angle_ra >= 360) return;
+    if (angle_dec < -90 || angle_dec > 90 || angle_ra < 0 || angle_ra >= 360) return false;
 
-    float r = to_rad(angle_ra);
-    float c = to_rad(angle_dec);
+    coord_t apparent = J2000_to_apparent({angle_dec, angle_ra});
     
-    auto dt = Clock::get_time();
-    float t = (float)dt.secondstime() / 31557600.0f / 100.0f;
+    return move_absolute(apparent.dec, to_360_range(apparent.ra));
+}
 
-    float M = to_rad(1.2812323f * t + 0.0003879f * t * t + 0.0000101f * t * t * t);
-    float N = to_rad(0.5567530f * t - 0.0001185f * t * t - 0.0000116f * t * t * t);
-    
-    float r_m = r + 0.5f * (M + N * sinf(r) * tanf(c));
-    float d_m = c + 0.5f * N * cosf(r_m);
-        
-    float r_c = r + M + N * sinf(r_m) * tanf(d_m);
-    float d_c = c + N * cosf(r_m);
+MountController::coord_t MountController::J2000_to_apparent(coord_t j2000) {
 
-    r_c = fmod(r_c, 2 * PI);
-    
-    move_absolute(to_deg(d_c), to_deg(r_c));
+    update_apparent();
+
+    // aberration is not a rotation, it shifts the direction towards the apex by v - (p.v) p
+
+    cartesian_t p = _apparent * polar_to_cartesian(j2000);
+    real_t p_dot_v = p.x * _aberration.x + p.y * _aberration.y + p.z * _aberration.z;
+    p.x += _aberration.x - p_dot_v * p.x;
+    p.y += _aberration.y - p_dot_v * p.y;
+    p.z += _aberration.z - p_dot_v * p.z;
+
+    // not needed for the direction, but the length is used by the fixed point atan2 
+    real_t norm = real_math::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+    coord_t apparent = cartesian_to_polar({p.x / norm, p.y / norm, p.z / norm});
+
+    #ifdef DEBUG_MOUNT
+        LOG(APPARENT_PLACE, j2000.dec, apparent.dec, j2000.ra, apparent.ra);
+    #endif
+
+    return apparent;
 }
 
-void MountController::move_absolute(deg_t angle_dec, deg_t angle_ra) {
+void MountController::update_apparent() {
 
-    if (angle_dec < -90 || angle_dec > 90 || angle_ra < 0 || angle_ra >= 360) return;
+    // IAU 1976 precession, the largest nutation terms and annual aberration from the Sun's 
+    // longitude (Meeus: Astronomical Algorithms, chapters 21 - 23), the error is below an 
+    // arc second which is more than enough, because everything changes so slowly, it is
+    // computed just once in a few minutes (or whenever the clock is set to another time) 
 
-    _motors.stop(); 
-    
-    coord_t target = polar_to_polar({angle_dec, to_time_global_ra(angle_ra)}, _transition);
-    coord_t o = get_local_mount_orientation();
+    uint32_t now = Clock::get_time().secondstime();
+    if (_apparent_valid && now - _apparent_time < APPARENT_REFRESH_S) return;
+
+    _apparent_time = now;
+    _apparent_valid = true;
+
+    // julian centuries since J2000.0 (which is at noon), TT - UT is neglected 
+    float t = ((float)now - 43200.0f) / 3155760000.0f;
+
+    float zeta  = (2306.2181f + (0.30188f + 0.017998f * t) * t) * t / 3600.0f;
+    float z     = (2306.2181f + (1.09468f + 0.018203f * t) * t) * t / 3600.0f;
+    float theta = (2004.3109f - (0.42665f + 0.041833f * t) * t) * t / 3600.0f;
+
+    float omega  = 125.04452f - 1934.136261f * t;
+    float l_sun  = 280.46646f + 36000.76983f * t;
+    float l_moon = 218.3165f + 481267.8813f * t;
+
+    float sin_o, cos_o, sin_2o, cos_2o, sin_2s, cos_2s, sin_2m, cos_2m;
+    sin_cos(omega, sin_o, cos_o);
+    sin_cos(2 * omega, sin_2o, cos_2o);
+    sin_cos(2 * l_sun, sin_2s, cos_2s);
+    sin_cos(2 * l_moon, sin_2m, cos_2m);
+
+    float d_psi = (-17.20f * sin_o - 1.32f * sin_2s - 0.23f * sin_2m + 0.21f * sin_2o) / 3600.0f;
+    float d_eps = (  9.20f * cos_o + 0.57f * cos_2s + 0.10f * cos_2m - 0.09f * cos_2o) / 3600.0f;
+    float eps = 23.43929111f - 0.0130041667f * t;
+
+    float sin_eps, cos_eps;
+    sin_cos(eps, sin_eps, cos_eps);
+
+    _apparent = get_ra_transition(d_psi * cos_eps) *
+                get_x_transition(-eps - d_eps) * get_ra_transition(-d_psi) * get_x_transition(eps) *
+                get_ra_transition(-z) * get_y_transition(theta) * get_ra_transition(-zeta);
+
+    // Earth moves perpendicularly to the direction of the Sun (circular orbit)
+    float anomaly = 357.52911f + 35999.05029f * t;
+    float sin_a, cos_a, sin_2a, cos_2a;
+    sin_cos(anomaly, sin_a, cos_a);
+    sin_cos(2 * anomaly, sin_2a, cos_2a);
+
+    float sin_l, cos_l;
+    sin_cos(l_sun + (1.914602f - 0.004817f * t) * sin_a + 0.019993f * sin_2a, sin_l, cos_l);
+
+    static const float kappa = 20.49552f / 3600.0f / 180.0f * M_PI;
+    _aberration = { kappa * sin_l, -kappa * cos_l * cos_eps, -kappa * cos_l * sin_eps };
+
+    #ifdef DEBUG_MOUNT
+        LOG(APPARENT_MATRIX, t);
+    #endif
+}
+
+bool MountController::move_absolute(deg_t angle_dec, deg_t angle_ra) {
+
+    if (angle_dec < -90 || angle_dec > 90 || angle_ra < 0 || angle_ra >= 360) return false;
+
+    stop_all(); 
     
-    coord_t revs = angle_to_revolutions({target.dec - o.dec, target.ra  - o.ra});
-    float travel_time = _motors.estimate_fast_turn_time(revs.dec, revs.ra) / 1000.0f / 3600.0f;
+    position_t from = get_local_mount_position();
+    coord_t revs = plan_slew(from, {angle_dec, to_time_global_ra(angle_ra)});
 
-    target = polar_to_polar({angle_dec, to_future_global_ra(angle_ra, travel_time)}, _transition);
-    revs = angle_to_revolutions({target.dec - o.dec, target.ra  - o.ra});
+    if (!is_path_safe(from, revs)) return false;
 
     #ifdef DEBUG_MOUNT
-        Serial.println(F("Turning at high speed by:"));
-        Serial.print(F("       DEC:  ")); Serial.println(target.dec - o.dec);
-        Serial.print(F("       RA:   ")); Serial.println(target.ra  - o.ra);
-        Serial.print(F("  tran DEC:  ")); Serial.print(angle_dec); Serial.print(F(" --> ")); Serial.println(target.dec);
-        Serial.print(F("  tran RA:   ")); Serial.print(angle_ra);  Serial.print(F(" --> ")); Serial.println(target.ra);
-        Serial.print(F("  revs DEC:  ")); Serial.println(revs.dec);
-        Serial.print(F("  revs RA:   ")); Serial.println(revs.ra);
+        LOG(GOTO, angle_dec, angle_ra, revs.dec, revs.ra);
     #endif
         
     _motors.fast_turn(revs.dec, revs.ra, false);
+    return true;
+}
+
+MountController::coord_t MountController::plan_slew(position_t from, coord_t target) {
+
+    // The sky rotates by less than a degree during any reasonable slew, so the fixed-point
+    // iteration converges very quickly (each step shrinks the error by the ratio of sky
+    // speed and slew speed), GOTO_MAX_ITERATIONS just guards against pathological cases.
+
+    coord_t revs;
+    float travel_ms = 0;
+
+    for (uint8_t i = 0; i < GOTO_MAX_ITERATIONS; ++i) {
+
+        float estimate_ms;
+        coord_t local = to_local({target.dec, target.ra + travel_ms * SIDEREAL_DEG_PER_MS});
+        revs = revolutions_fastest(from, local, estimate_ms);
+
+        float change_ms = fabs(estimate_ms - travel_ms);
+        travel_ms = estimate_ms;
+
+        #ifdef DEBUG_MOUNT
+            LOG(SLEW_PLANNING, i, travel_ms, change_ms);
+        #endif
+
+        if (change_ms < GOTO_TIME_TOLERANCE_MS) break;
+    }
+
+    return revs;
+}
+
+MountController::coord_t MountController::revolutions_fastest(position_t from, coord_t to, float& duration_ms) {
+
+    static const bam64_t dec_min = DEC_LIMIT_MIN * BAM_PER_DEG;
+    static const bam64_t dec_max = DEC_LIMIT_MAX * BAM_PER_DEG;
+    static const bam64_t ra_min  = RA_LIMIT_MIN  * BAM_PER_DEG;
+    static const bam64_t ra_max  = RA_LIMIT_MAX  * BAM_PER_DEG;
+
+    boolean found = false;
+    coord_t best;
+
+    for (uint8_t f = 0; f < 2; ++f) {
+        
+        coord_t local = f ? flip(to) : to;
+        bam64_t dec = (int32_t)deg_to_bam(local.dec);
+        if (dec < dec_min || dec > dec_max) continue;
+
+        // RA of flipped positions is up to 1.5 turns, so two turns to both sides are enough
+        for (int8_t k = -2; k <= 2; ++k) {
+
+            bam64_t ra = (bam64_t)deg_to_bam(local.ra) + k * BAM_TURN;
+            if (ra < ra_min || ra > ra_max) continue;
+
+            coord_t revs = revolutions_between(from, {dec, ra});
+            float ms = _motors.estimate_fast_turn_time(revs.dec, revs.ra);
+
+            if (!found || ms < duration_ms) {
+                found = true;
+                duration_ms = ms;
+                best = revs;
+            }
+        }
+    }
+
+    if (!found) {
+        best = revolutions_between(from, {(int32_t)deg_to_bam(to.dec), (bam64_t)deg_to_bam(to.ra)});
+        duration_ms = _motors.estimate_fast_turn_time(best.dec, best.ra);
+    }
+
+    return best;
+}
+
+boolean MountController::is_safe(position_t position) {
+
+    static const bam64_t dec_min = DEC_LIMIT_MIN * BAM_PER_DEG;
+    static const bam64_t dec_max = DEC_LIMIT_MAX * BAM_PER_DEG;
+    static const bam64_t ra_min  = RA_LIMIT_MIN  * BAM_PER_DEG;
+    static const bam64_t ra_max  = RA_LIMIT_MAX  * BAM_PER_DEG;
+
+    if (position.dec < dec_min || position.dec > dec_max || 
+        position.ra  < ra_min  || position.ra  > ra_max) return false;
+
+    int32_t dec = position.dec;
+    bam_t ra = position.ra;
+
+    // DEC' = +-180 - DEC and RA' = RA + 180 (see flip) in binary angles
+    if (is_flipped(position)) {
+        dec = (int32_t)(0x80000000UL - (uint32_t)dec);
+        ra += 0x80000000UL;
+    }
+
+    return !_keep_out.is_blocked(dec, ra);
+}
+
+boolean MountController::is_path_safe(position_t from, coord_t revs) {
+
+    static const float step = 0.5f * KEEP_OUT_CELL_DEG * min(Dec::REVS_PER_DEG, Ra::REVS_PER_DEG);
+
+    float dec_revs = fabs(revs.dec);
+    float ra_revs  = fabs(revs.ra);
+    float length = max(dec_revs, ra_revs);
+
+    for (float r = 0; ; r += step) {
+
+        if (r > length) r = length;
+
+        position_t p = { from.dec + Dec::revs_to_bam(Dec::revs_t(copysign(min(r, dec_revs), revs.dec))),
+                         from.ra  + Ra::revs_to_bam(Ra::revs_t(copysign(min(r, ra_revs),  revs.ra))) };
+
+        if (!is_safe(p)) {
+            #ifdef DEBUG_MOUNT
+                LOG(SLEW_REFUSED, bam64_to_deg(p.dec), bam64_to_deg(p.ra));
+            #endif
+            return false;
+        }
+
+        if (r == length) return true;
+    }
 }
 
-void MountController::move_relative_local(deg_t angle_dec, deg_t angle_ra) {
+bool MountController::move_relative_local(deg_t angle_dec, deg_t angle_ra) {
 
     coord_t curr_pos = get_local_mount_orientation();
 
     angle_dec = fmod(angle_dec, 180);
     angle_ra  = fmod(angle_ra,  360);
 
-    // DEC cannot exceed -90..90 degrees
-    if (curr_pos.dec + angle_dec < -90) angle_dec = -90 - curr_pos.dec;
-    else if (curr_pos.dec + angle_dec > 90) angle_dec = 90 - curr_pos.dec;
+    // DEC cannot exceed -90..90 degrees (unless the mount can go over its pole)
+    if (curr_pos.dec + angle_dec < DEC_LIMIT_MIN) angle_dec = DEC_LIMIT_MIN - curr_pos.dec;
+    else if (curr_pos.dec + angle_dec > DEC_LIMIT_MAX) angle_dec = DEC_LIMIT_MAX - curr_pos.dec;
 
     // RA can, but should not exceed 0..360 because of wires etc.
-    if (curr_pos.ra + angle_ra < 0) angle_ra = -curr_pos.ra;
-    else if (curr_pos.ra + angle_ra > 360) angle_ra = 360 - curr_pos.ra;
+    if (curr_pos.ra + angle_ra < RA_LIMIT_MIN) angle_ra = RA_LIMIT_MIN - curr_pos.ra;
+    else if (curr_pos.ra + angle_ra > RA_LIMIT_MAX) angle_ra = RA_LIMIT_MAX - curr_pos.ra;
 
     coord_t revs = angle_to_revolutions({angle_dec, angle_ra});
+    if (!is_path_safe(get_local_mount_position(), revs)) return false;
 
     #ifdef DEBUG_MOUNT
-        Serial.println(F("Turning at high speed by:"));
-        Serial.print(F("  DEC:  ")); Serial.println(angle_dec);
-        Serial.print(F("  RA:   ")); Serial.println(angle_ra);
-        Serial.print(F("  revs DEC:  ")); Serial.println(revs.dec, 7);
-        Serial.print(F("  revs RA:   ")); Serial.println(revs.ra, 7);
+        LOG(TURN_BY, angle_dec, angle_ra, revs.dec, revs.ra);
     #endif
         
     _motors.fast_turn(revs.dec, revs.ra, false);
+    return true;
 }
 
-void MountController::move_relative_global(deg_t angle_dec, deg_t angle_ra) {
+bool MountController::move_relative_global(deg_t angle_dec, deg_t angle_ra) {
 
     angle_dec = to_180_range(fmod(angle_dec, 360));
     angle_ra  = to_180_range(fmod(angle_ra,  360));
 
-    coord_t curr_pos = get_local_mount_orientation();  
-    coord_t curr_global = polar_to_polar(curr_pos, _transition_inverse);
+    position_t p = get_local_mount_position();
+    coord_t curr_pos = { bam64_to_deg(p.dec), bam64_to_deg(p.ra) };  
+    coord_t curr_global = to_global(curr_pos);
 
     // new desired global pos DEC can also change RA if exceeds bounds
 
@@ -271,50 +419,135 @@ void MountController::move_relative_global(deg_t angle_dec, deg_t angle_ra) {
     curr_global.ra = fmod(curr_global.ra + angle_ra, 360);
     if (curr_global.ra < 0) curr_global.ra += 360;
 
-    coord_t new_pos = polar_to_polar(curr_global, _transition);
-    coord_t revs = angle_to_revolutions({new_pos.dec - curr_pos.dec, new_pos.ra - curr_pos.ra});
-    
-    float travel_time = _motors.estimate_fast_turn_time(revs.dec, revs.ra) / 1000.0f * 15.0f / 3600.0f; 
-    curr_global.ra = fmod(curr_global.ra + travel_time, 360);
-
-    new_pos = polar_to_polar(curr_global, _transition);
-    revs = angle_to_revolutions({new_pos.dec - curr_pos.dec, new_pos.ra - curr_pos.ra});
+    coord_t revs = plan_slew(p, curr_global);
+    if (!is_path_safe(p, revs)) return false;
 
     #ifdef DEBUG_MOUNT
-        Serial.println(F("Turning at high speed by:"));
-        Serial.print(F("  DEC:  ")); Serial.println(new_pos.dec - curr_pos.dec);
-        Serial.print(F("  RA:   ")); Serial.println(new_pos.ra  - curr_pos.ra);
-        Serial.print(F("  revs DEC:  ")); Serial.println(revs.dec);
-        Serial.print(F("  revs RA:   ")); Serial.println(revs.ra);
+        LOG(TURN_BY, angle_dec, angle_ra, revs.dec, revs.ra);
     #endif
         
     _motors.fast_turn(revs.dec, revs.ra, false);
+    return true;
 }
 
 void MountController::set_tracking() {
 
-    // TODO: it would be nice to change the speed dynamically after some time, based on the time
-    // ellapsed from the start of the movement. Unfortunately it would require a schedule 
-    // of steppers speed and a clever correction (we are doing a conversion of a complex
-    // sin/cos/sqrt function into a simple stair function) and it is hard.
+    // Speeds of motors are not constant for improperly aligned mounts, so we approximate
+    // the movement by a stair function of speeds, each stair is a single queued movement
+    // (which follows the previous one without stopping motors) and the speed is computed
+    // for the middle of the stair
 
-    float w = 15.0f;
-    
-    coord_t target = get_global_mount_orientation();
-    coord_t speed = get_ra_speed_transform(w, 0.0f, target, _mount_pole, _mount_ra_offset);
+    _tracking_target = get_global_mount_orientation();
+    _tracking_start_ms = millis();
+    _tracking_scheduled_ms = 0;
+    _motors.get_target_pulses(_tracking_end_dec, _tracking_end_ra);
 
     #ifdef DEBUG_MOUNT
-        Serial.println(F("Tracking:"));
-        Serial.print(F("  target DEC: ")); Serial.println(target.dec);
-        Serial.print(F("  target RA:  ")); Serial.println(target.ra);
-        Serial.print(F("  speed DEC (dps): ")); Serial.println(speed.dec / 3600.0f, 7);  // 0.0 
-        Serial.print(F("  speed RA (dps):  ")); Serial.println(speed.ra  / 3600.0f, 7);  // 0.0041667
+        LOG(TRACKING, _tracking_target.dec, _tracking_target.ra);
     #endif
 
-    speed = angle_to_revolutions(speed);
-    _motors.slow_turn(speed.dec, speed.ra, speed.dec / 3600.0f, speed.ra / 3600.0f, true);
-    
     _is_tracking = true;
+    update_tracking();
+}
+
+void MountController::update_tracking() {
+
+    // the object went behind the horizon or the mount is going to hit the tripod
+    if (!is_safe(get_local_mount_position())) {
+        stop_tracking();
+        return;
+    }
+
+    if (_tracking_mode == TRACKING_POSITIONS) {
+
+        // the next movement starts where the running one ends, so it must be the only one 
+        if (_motors.queued_commands() > 0) return;
+
+        // the running movement has just started from the queue and the next one starts at its
+        // end (slow turns last as commanded), or now if motors stopped because update was not
+        // called for a while, so late movements do not accumulate
+        unsigned long elapsed_ms = millis() - _tracking_start_ms;
+        _tracking_scheduled_ms = elapsed_ms + _motors.get_remaining_ms() + TRACKING_CORRECTION_MS;
+        queue_tracking_correction(_tracking_scheduled_ms, TRACKING_CORRECTION_MS);
+
+    } else {
+
+        // the schedule restarts from now and from the position of the motors if they ran out of
+        // segments (update was not called for a while or an empty one finished immediately)
+        unsigned long elapsed_ms = millis() - _tracking_start_ms;
+        if (_motors.is_ready() && _motors.queued_commands() == 0) {
+            _tracking_scheduled_ms = elapsed_ms;
+            _motors.get_target_pulses(_tracking_end_dec, _tracking_end_ra);
+        }
+
+        // bounded, because empty segments are not queued but executed (and finished) immediately
+        for (uint8_t i = 0; i <= TRACKING_SEGMENTS_AHEAD && _motors.queued_commands() < TRACKING_SEGMENTS_AHEAD; ++i) {
+            queue_tracking_segment(_tracking_scheduled_ms, TRACKING_SEGMENT_MS);
+            _tracking_scheduled_ms += TRACKING_SEGMENT_MS;
+        }
+    }
+}
+
+void MountController::queue_tracking_correction(unsigned long end_ms, unsigned long duration_ms) {
+
+    // The position is computed from the current time (LST) and the exact number of pulses 
+    // which will have been made at the end of the running movement, so errors caused by 
+    // rounding of speeds or missed ticks are corrected by the next movement and the error 
+    // is bounded by the movement duration instead of growing with time
+
+    Dec::pulses_t dec_pulses;
+    Ra::pulses_t ra_pulses;
+    _motors.get_target_pulses(dec_pulses, ra_pulses);
+    position_t from = { Dec::pulses_to_bam(dec_pulses), Ra::pulses_to_bam(ra_pulses) };
+
+    float hours_ahead = ((long)end_ms - (long)(millis() - _tracking_start_ms)) / 3600000.0f;
+    coord_t target = to_local({_tracking_target.dec, to_future_global_ra(_tracking_target.ra, hours_ahead)});
+    coord_t revs = revolutions_nearby(from, target);
+
+    // corrections are bounded, so the mount catches up slowly after long interruptions
+    float seconds = duration_ms / 1000.0f;
+    coord_t max_revs = angle_to_revolutions({TRACKING_MAX_RATE * seconds, TRACKING_MAX_RATE * seconds});
+    revs.dec = constrain(revs.dec, -max_revs.dec, max_revs.dec);
+    revs.ra  = constrain(revs.ra,  -max_revs.ra,  max_revs.ra);
+
+    #ifdef DEBUG_MOUNT
+        LOG(TRACKING_CORRECTION, end_ms, revs.dec, revs.ra);
+    #endif
+
+    _motors.slow_turn(revs.dec, revs.ra, fabs(revs.dec) / seconds, fabs(revs.ra) / seconds, true);
+}
+
+void MountController::queue_tracking_segment(unsigned long start_ms, unsigned long duration_ms) {
+
+    float hours = duration_ms / 3600000.0f;
+    float middle = ((long)(start_ms + duration_ms / 2) - (long)(millis() - _tracking_start_ms)) / 3600000.0f;
+
+    // speed (deg per hour) for the position of the target in the middle of the segment
+    coord_t point = {_tracking_target.dec, to_future_global_ra(_tracking_target.ra, middle)};
+    coord_t speed = get_axis_rates(point, SIDEREAL_DEG_PER_MS * 3600000.0f);
+
+    // DEC moves in the opposite direction on the other side of the pole of the mount 
+    if (is_flipped(get_local_mount_position())) speed.dec = -speed.dec;
+    coord_t revs = angle_to_revolutions({speed.dec * hours, speed.ra * hours});
+
+    // The segment also makes up the difference between the object and the end of the previous
+    // segment at its start (the exact number of pulses, not the sum of rounded speeds), so the
+    // schedule is anchored to the sky and the error of speeds does not accumulate
+    position_t from = { Dec::pulses_to_bam(_tracking_end_dec), Ra::pulses_to_bam(_tracking_end_ra) };
+    float hours_ahead = ((long)start_ms - (long)(millis() - _tracking_start_ms)) / 3600000.0f;
+    coord_t residual = revolutions_nearby(from, to_local({_tracking_target.dec, to_future_global_ra(_tracking_target.ra, hours_ahead)}));
+    revs.dec += residual.dec;
+    revs.ra += residual.ra;
+
+    _tracking_end_dec += Dec::revs_to_pulses(Dec::revs_t(revs.dec));
+    _tracking_end_ra += Ra::revs_to_pulses(Ra::revs_t(revs.ra));
+
+    #ifdef DEBUG_MOUNT
+        LOG(TRACKING_SEGMENT, start_ms, speed.dec / 3600.0f, speed.ra / 3600.0f);  // 0.0 and 0.0041667 at the pole
+    #endif
+
+    float seconds = duration_ms / 1000.0f;
+    _motors.slow_turn(revs.dec, revs.ra, fabs(revs.dec) / seconds, fabs(revs.ra) / seconds, true);
 }
 
 void MountController::set_parking() {
@@ -325,29 +558,34 @@ void MountController::set_parking() {
     _motors.fast_turn(-dec_revs_done, -ra_revs_done, false);
 }
 
-MountController::coord_t MountController::get_ra_speed_transform(deg_t ra_speed, float t, coord_t point, coord_t pole, deg_t ra_offset) {
+MountController::coord_t MountController::get_axis_rates(coord_t point, deg_t ra_speed) {
+
+    //  1) derivative of global cartesian coordinates p w. r. to global RA is (-p.y, p.x, 0)
+    //  2) local coordinates are q = T * p, so their derivative is T * dp (T is linear)
+    //  3) DEC = atan2(q.z, |q.xy|), so its derivative is dq.z / |q.xy| for unit vectors
+    //  4) RA = atan2(q.y, q.x), so its derivative is (q.x * dq.y - q.y * dq.x) / |q.xy|^2
+    //
+    // The refraction changes with altitude, so the derivative of the refracted point is
+    // approximated by the central difference (in global coordinates) before step 2.
 
-    // Ugly and hardcoded derivative :-(
+    if (_mount_type == EQUATORIAL && REFRACTION_PRESSURE <= 0) return coord_t { 0.0f, ra_speed };
 
-    //  1) take x, y, z of a point based on start point, time and angle velocity
-    //  2) transform into z' (like using _transform), but matrices must be hardcoded because of the next step
-    //  3) take derivative dz'/dt
-    //  4) compute derivatives of dec angle velocity: w_dec = (dz'/dt) / sqrt(1 - z'^2)
-    //  5) ra angle velocity w_ra^2 = 1 - w_dec^2
+    static const real_t h = 0.001f;
 
-    double coscos = cos(to_rad(pole.dec)) * cos(to_rad(point.dec));
-    double sinsin = sin(to_rad(pole.ra))  * sin(to_rad(point.dec));
-    double real_ra = to_rad(point.ra - ra_offset + ra_speed * t);
+    cartesian_t p = polar_to_cartesian(point);
+    cartesian_t a = refract(cartesian_t { p.x - h * p.y, p.y + h * p.x, p.z }, false);
+    cartesian_t b = refract(cartesian_t { p.x + h * p.y, p.y - h * p.x, p.z }, false);
+    
+    cartesian_t q = _transition * refract(p, false);
+    cartesian_t dq = _transition * cartesian_t { (a.x - b.x) / (h + h), (a.y - b.y) / (h + h), (a.z - b.z) / (h + h) };
 
-    double z_transformed = sinsin - coscos * cos(real_ra);
-    double z_derivative  = coscos * sin(real_ra);
+    float xy_squared = (float)(q.x * q.x + q.y * q.y);
 
-    double w_dec = sqrt(1.0 - z_transformed * z_transformed);
-    if (w_dec <= 0) w_dec = 0.0f;
-    else w_dec = z_derivative / w_dec; // arcsin derivative
-    float w_ra = sqrt(1.0 - w_dec);
+    // the point is at the pole of the mount, where the RA axis is not defined
+    if (xy_squared < 1e-10f) return coord_t { 0.0f, 0.0f };
 
-    return coord_t { ra_speed * w_dec, ra_speed * w_ra };
+    return coord_t { ra_speed * (float)dq.z / sqrt(xy_squared),
+                     ra_speed * (float)(q.x * dq.y - q.y * dq.x) / xy_squared };
 }
 
 void MountController::stop_tracking() {
@@ -358,31 +596,104 @@ void MountController::stop_tracking() {
     _is_tracking = false;
 }
 
-MountController::cartesian_t MountController::polar_to_cartesian(coord_t polar) {
+MountController::coord_t MountController::to_local(coord_t global) {
+
+    switch (_mount_type) {
+
+        // the pole is the celestial pole, so the mount just rotates around it
+        case EQUATORIAL: 
+            global = refract(global, false);
+            return coord_t { global.dec, to_360_range(global.ra - _ra_shift) };
+
+        // the pole is the zenith, turn it to RA 0, tilt by the latitude and rotate by RA offset,
+        // DEC of the mount is then the altitude, so the refraction is just added to it
+        case ALTAZIMUTHAL: {
+            cartesian_t p = polar_to_cartesian({global.dec, global.ra - _mount_pole.ra});
+            coord_t local = cartesian_to_polar({ _pole_sin_dec * p.x - _pole_cos_dec * p.z, p.y, 
+                                                 _pole_cos_dec * p.x + _pole_sin_dec * p.z });
+            if (REFRACTION_PRESSURE > 0) local.dec += refraction_true_to_apparent(local.dec);
+            local.ra = to_360_range(local.ra - _ra_shift);
+            return local;
+        }
+
+        default:
+            return cartesian_to_polar(_transition * refract(polar_to_cartesian(global), false));
+    }
+}
+
+MountController::coord_t MountController::to_global(coord_t local) {
+
+    switch (_mount_type) {
+
+        case EQUATORIAL: 
+            return refract(coord_t { local.dec, to_360_range(local.ra + _ra_shift) }, true);
+
+        case ALTAZIMUTHAL: {
+            if (REFRACTION_PRESSURE > 0) local.dec -= refraction_apparent_to_true(local.dec);
+            cartesian_t p = polar_to_cartesian({local.dec, local.ra + _ra_shift});
+            coord_t global = cartesian_to_polar({  _pole_sin_dec * p.x + _pole_cos_dec * p.z, p.y, 
+                                                  -_pole_cos_dec * p.x + _pole_sin_dec * p.z });
+            global.ra = to_360_range(global.ra + _mount_pole.ra);
+            return global;
+        }
+
+        default:
+            return cartesian_to_polar(refract(_transition_inverse * polar_to_cartesian(local), true));
+    }
+}
+
+MountController::cartesian_t MountController::refract(cartesian_t point, boolean inverse) {
+
+    real_t s, c;
+    float r = refraction_angle(point, inverse, s, c);
+    return r == 0 ? point : rotate_to_zenith(point, r, s, c);
+}
+
+MountController::coord_t MountController::refract(coord_t point, boolean inverse) {
 
-    double rad_dec = to_rad(polar.dec);
-    double rad_ra  = to_rad(polar.ra);
-    double cos_dec = cos(rad_dec);
+    if (REFRACTION_PRESSURE <= 0) return point;
 
-    return cartesian_t { cos_dec * cos(rad_ra),
-                         cos_dec * sin(rad_ra),
-                         sin(rad_dec) };
+    real_t s, c;
+    cartesian_t p = polar_to_cartesian(point);
+    float r = refraction_angle(p, inverse, s, c);
+    return r == 0 ? point : cartesian_to_polar(rotate_to_zenith(p, r, s, c));
 }
 
-MountController::coord_t MountController::cartesian_to_polar(cartesian_t cartesian) {
+float MountController::refraction_angle(cartesian_t point, boolean inverse, real_t& s, real_t& c) {
+
+    if (REFRACTION_PRESSURE <= 0) return 0;
+
+    s = point.x * _zenith.x + point.y * _zenith.y + point.z * _zenith.z;
+    real_t c_squared = real_t(1.0f) - s * s;
 
-    // TODO: this function should be rewritten to reach a better precision (asin)
+    // refraction vanishes at zenith (and the direction towards it is not defined)
+    if ((float)c_squared < 1e-8f) return 0;
+    c = real_math::sqrt(c_squared);
 
-    double ra = to_deg(atan2(cartesian.y, cartesian.x));
-    if (ra < 0) ra += 360;
-       
-    return coord_t { to_deg(asin(cartesian.z)), ra};
+    float altitude = real_math::atan2(s, c);
+    float r = to_rad(inverse ? -refraction_apparent_to_true(altitude) : refraction_true_to_apparent(altitude));
+
+    // coordinates of unit vectors would not change (a few hundredths of a degree from the zenith)
+    return fabs(r) < 1e-7f ? 0 : r;
+}
+
+MountController::cartesian_t MountController::rotate_to_zenith(cartesian_t point, float r, real_t s, real_t c) {
+
+    // (zenith - s * point) / c is the unit tangent towards zenith, refraction is below 
+    // one degree, so sin(r) = r and cos(r) = 1 - r^2 / 2 are precise enough
+
+    real_t k = real_t(r) / c;
+    real_t cos_r = 1.0f - 0.5f * r * r;
+
+    return cartesian_t { cos_r * point.x + k * (_zenith.x - s * point.x),
+                         cos_r * point.y + k * (_zenith.y - s * point.y),
+                         cos_r * point.z + k * (_zenith.z - s * point.z) };
 }
 
 MountController::matrix_t MountController::get_dec_transition(deg_t dec) {
 
-    double cos_dec = cos(to_rad(dec));
-    double sin_dec = sin(to_rad(dec));
+    real_t sin_dec, cos_dec;
+    real_math::sin_cos(dec, sin_dec, cos_dec);
 
     return matrix_t {
         {{ sin_dec, 0, -cos_dec },
@@ -393,8 +704,8 @@ MountController::matrix_t MountController::get_dec_transition(deg_t dec) {
 
 MountController::matrix_t MountController::get_dec_transition_inverse(deg_t dec) {
 
-    double cos_dec = cos(to_rad(dec));
-    double sin_dec = sin(to_rad(dec));
+    real_t sin_dec, cos_dec;
+    real_math::sin_cos(dec, sin_dec, cos_dec);
     
     return matrix_t {
         {{ sin_dec, 0, cos_dec},
@@ -405,8 +716,8 @@ MountController::matrix_t MountController::get_dec_transition_inverse(deg_t dec)
 
 MountController::matrix_t MountController::get_ra_transition(deg_t ra) {
 
-    double cos_ra = cos(to_rad(ra));
-    double sin_ra = sin(to_rad(ra));
+    real_t sin_ra, cos_ra;
+    real_math::sin_cos(ra, sin_ra, cos_ra);
 
     return matrix_t {
         {{  cos_ra, sin_ra, 0},
@@ -417,8 +728,8 @@ MountController::matrix_t MountController::get_ra_transition(deg_t ra) {
 
 MountController::matrix_t MountController::get_ra_transition_inverse(deg_t ra) {
 
-    double cos_ra = cos(to_rad(ra));
-    double sin_ra = sin(to_rad(ra));
+    real_t sin_ra, cos_ra;
+    real_math::sin_cos(ra, sin_ra, cos_ra);
 
     return matrix_t {
         {{ cos_ra, -sin_ra, 0},
@@ -427,6 +738,30 @@ MountController::matrix_t MountController::get_ra_transition_inverse(deg_t ra) {
     };
 }
 
+MountController::matrix_t MountController::get_x_transition(deg_t angle) {
+
+    real_t sine, cosine;
+    real_math::sin_cos(angle, sine, cosine);
+
+    return matrix_t {
+        {{ 1,  0,      0      },
+         { 0,  cosine, sine   },
+         { 0, -sine,   cosine }}
+    };
+}
+
+MountController::matrix_t MountController::get_y_transition(deg_t angle) {
+
+    real_t sine, cosine;
+    real_math::sin_cos(angle, sine, cosine);
+
+    return matrix_t {
+        {{ cosine, 0, -sine   },
+         { 0,      1,  0      },
+         { sine,   0,  cosine }}
+    };
+}
+
 float MountController::random_normal() {
 
     static const long rnd_max = 1000000;
@@ -6,33 +6,77 @@
 #include "../config.h"
 #include "motor_controller.h"
 #include "clock.h"
+#include "angle.h"
+#include "trig.h"
+#include "coords.h"
+#include "refraction.h"
+#include "keep_out.h"
 
 class MountController {
   
   public:
 
     using deg_t = float;
-    struct coord_t { float dec; float ra; };
-    struct cartesian_t { float x; float y; float z; };
+    using coord_t = polar_t;
+
+    // unit conversions of motors and gears of both axes (see core/axis.h)
+    using Dec = MotorController::Dec;
+    using Ra = MotorController::Ra;
+
+    // scalar type of cartesian vectors and rotation matrices (see MOUNT_REAL)
+    using real_t = MOUNT_REAL;
+    using real_math = scalar_math<real_t>;
+    using cartesian_t = cartesian<real_t>;
+
+    // kind of the mount given by its pole, perfectly aligned equatorial and altazimuthal
+    // mounts can skip the general rotation and use cheaper specialized transforms
+    enum mount_type_t : uint8_t { EQUATORIAL, ALTAZIMUTHAL, GENERAL };
 
     MountController(MotorController& mc) : _motors(mc) {}
 
     // initialize stepper motors, default values, call from setup!
     void initialize();
 
+    // background jobs (refilling of the tracking schedule), call from loop!
+    void update();
+
     inline void get_mount_pole(coord_t& pole, deg_t& ra_offset) {
         pole = _mount_pole;
         ra_offset = _mount_ra_offset;
     }  
 
-    // set mount pole to point at global equatorial coordinates 'pole' with a RA offset of 'ra_offset' degrees 
-    inline void set_mount_pole(coord_t pole, deg_t ra_offset) {
+    // set mount pole to point at global equatorial coordinates 'pole' with a RA offset of 'ra_offset' degrees,
+    // the general rotation is used for any pole if not 'fast_paths' (e.g. to compare it with them)
+    inline void set_mount_pole(coord_t pole, deg_t ra_offset, boolean fast_paths = true) {
         _transition = make_transition_matrix(pole, ra_offset);
         _transition_inverse = make_inverse_transition_matrix(pole, ra_offset);
         _mount_pole = pole;
         _mount_ra_offset = ra_offset;
+        _mount_type = fast_paths ? get_mount_type(pole) : GENERAL;
+        _ra_shift = (_mount_type == EQUATORIAL ? pole.ra + ra_offset : ra_offset);
+        real_math::sin_cos(pole.dec, _pole_sin_dec, _pole_cos_dec);
     }
 
+    // type of the mount derived from its pole, see POLE_TOLERANCE
+    inline mount_type_t get_mount_type() { return _mount_type; }
+
+    // converts global (time dependent) equatorial coordinates into the mount coordinates, the
+    // point is refracted first and then it is the same as polar_to_polar(global, _transition) 
+    // but dispatches to a fast path (alt-az mounts refract their DEC, which is the altitude)
+    coord_t to_local(coord_t global);
+
+    // converts the mount coordinates into global (time dependent) equatorial coordinates,
+    // this is the same as polar_to_polar(local, _transition_inverse) but uses fast paths,
+    // the refraction is removed from the result
+    coord_t to_global(coord_t local);
+
+    // Returns angular speeds (DEC, RA) of mount axes needed to follow a point with global
+    // coordinates 'point' (DEC, time dependent RA, see to_time_global_ra) which moves by 
+    // 'ra_speed' in global RA (and does not move in DEC). Speeds are in the same units as 
+    // 'ra_speed'. Computed from the analytic Jacobian of the transition, so it is valid for 
+    // any pole, any position (except for the pole of the mount itself) and any mount type.
+    coord_t get_axis_rates(coord_t point, deg_t ra_speed);
+
     // orientation of mount in the global equatorial coordinates (DEC, RA)
     coord_t get_global_mount_orientation();
 
@@ -43,23 +87,38 @@ class MountController {
     void all_star_alignment(coord_t kernel[], coord_t image[], uint8_t points_num);
 
     // same as move_absolute method but with JToDate correction of J2000 cordinates
-    void move_absolute_J2000(deg_t angle_dec, deg_t angle_ra);
+    bool move_absolute_J2000(deg_t angle_dec, deg_t angle_ra);
+
+    // converts J2000 (catalogue) coordinates into apparent coordinates of the current date,
+    // i.e. applies precession, nutation and annual aberration, the matrix is cached so the
+    // conversion is cheap and can be used for many objects (see APPARENT_REFRESH_S)
+    coord_t J2000_to_apparent(coord_t j2000);
 
-    // moves the mount in order to point at the target in absolute coordinates (at max speed)
-    void move_absolute(deg_t angle_dec, deg_t angle_ra);
+    // moves the mount in order to point at the target in absolute coordinates (at max speed),
+    // returns false and does not move if the slew would cross the keep-out map (see is_path_safe)
+    bool move_absolute(deg_t angle_dec, deg_t angle_ra);
 
     // moves a bit relatively to the current mount orientation (at max speed in mount coord. sys.)
-    void move_relative_local(deg_t angle_dec, deg_t angle_ra);
+    bool move_relative_local(deg_t angle_dec, deg_t angle_ra);
 
     // moves a bit relatively to the current mount orientation (at max speed in equatorial coord. sys.)
-    void move_relative_global(deg_t angle_dec, deg_t angle_ra);
+    bool move_relative_global(deg_t angle_dec, deg_t angle_ra);
 
-    // starts tracking the object for an hour given the current mount orientation, also adapts
-    // the speed of motors in RA and DEC according to starting position (so it should  a little but 
-    // compensate improperly calibrated mount), however this SPEED MIGHT BE IRRELEVANT ONCE THE TRACKING
-    // IS RUNNING FOR A LONG TIME AND/OR THE MOUNT IS VERY POORLY CALIBRATED (i.e. its pole is at 45 DEC)
+    // map of forbidden directions of the mount, checked by all slews, jogs and tracking
+    inline KeepOutMap& get_keep_out() { return _keep_out; }
+
+    // starts tracking the object given the current mount orientation, the tracking is a schedule
+    // of short movements (TRACKING_SEGMENT_MS long) with speeds of RA and DEC motors computed for 
+    // the time of each segment, so it compensates improperly calibrated mounts even if the needed
+    // speeds change during the night, segments are queued in advance and refilled by update(),
+    // or (see TRACKING_MODE) a chain of TRACKING_CORRECTION_MS long movements, each of them
+    // ends at the exact position of the object in the time of its end
     void set_tracking();
 
+    // selects TRACKING_RATES or TRACKING_POSITIONS, call before set_tracking, TRACKING_MODE is
+    // the default (the firmware keeps it, host tools compare the modes)
+    inline void set_tracking_mode(uint8_t mode) { _tracking_mode = mode; }
+
     // moves the mount to 0, 0 in local coordinates
     void set_parking();
 
@@ -69,67 +128,99 @@ class MountController {
     // stops motors just is tracking
     void stop_tracking();
 
-    // check whether motors do move
-    inline boolean is_moving() { return !_motors.is_ready(); }
+    // refines the model of slew durations by the last finished slew, true if the model changed
+    inline bool learn_slew_duration() { return _motors.learn_slew_duration(); }
+
+    inline const MotorController::slew_model_t& get_slew_model() { return _motors.get_slew_model(); }
+    inline void set_slew_model(const MotorController::slew_model_t& model) { _motors.set_slew_model(model); }
+
+    // check whether motors do move (or are about to start a queued movement, e.g. the residual
+    // slow turn of a slew, motors stand still for a tick between queued movements)
+    inline boolean is_moving() { return !_motors.is_ready() || _motors.queued_commands() > 0; }
 
     // check whether we are tracking something
     inline boolean is_tracking() { return _is_tracking; }
 
     static float to_time_global_ra(float ra) {
         // see _mount_pole comments in for the explanation of 180-...
-        return fmod(180 - ra +  15 * Clock::get_decimal_LST(), 360);
+        return fmod(180 - ra + bam_to_deg(Clock::get_LST_angle()), 360);
     }
 
     static float to_future_global_ra(float ra, float decimal_future_hours) {
         // see _mount_pole comments in for the explanation of 180-...
-        return fmod(180 - ra +  15 * (Clock::get_decimal_LST() + decimal_future_hours), 360);
+        // future hours are solar (of millis), the sky turns by 15 degrees in a sidereal hour
+        return fmod(180 - ra + 15 * Clock::get_decimal_LST() + decimal_future_hours * (SIDEREAL_DEG_PER_MS * 3600000.0f), 360);
     }
 
   private:
 
-    struct matrix_t {
-
-        double data[3][3];
-        
-        matrix_t& operator*= (matrix_t const & b){
-            matrix_t product = {};
-            for (int i = 0; i < 3; i++)
-                for (int j = 0; j < 3; j++) 
-                    for (int k = 0; k < 3; k++) {
-                        product.data[i][j] += data[i][k] * b.data[k][j];
-                    }
-            for (int i = 0; i < 3; i++)
-                for (int j = 0; j < 3; j++){
-                    data[i][j] = product.data[i][j];
-                }
-            return *this;
-        }
-
-        friend matrix_t operator*(matrix_t left, matrix_t const & right) {
-            left *= right;
-            return left;
-        }
-
-        friend cartesian_t operator*(matrix_t const & left, cartesian_t const & right) {
-            return cartesian_t {
-                left.data[0][0] * right.x + left.data[0][1] * right.y + left.data[0][2] * right.z,
-                left.data[1][0] * right.x + left.data[1][1] * right.y + left.data[1][2] * right.z,
-                left.data[2][0] * right.x + left.data[2][1] * right.y + left.data[2][2] * right.z,
-            };
-        }
-    };
+    // position of mount axes as binary angles, RA is not wrapped around 360 (because of wires)
+    struct position_t { bam64_t dec; bam64_t ra; };
+
+    using matrix_t = matrix<real_t>;
 
     inline float to_deg(float rad) { return rad / M_PI * 180; }
     inline float to_rad(float deg) { return deg / 180 * M_PI; }
 
+    // sine and cosine of an angle given in degrees, see FAST_TRIG
+    inline void sin_cos(float deg, float& sine, float& cosine) {
+        scalar_math<float>::sin_cos(deg, sine, cosine);
+    }
+
     coord_t angle_to_revolutions(coord_t angles) {
-        return { angles.dec * REDUCTION_RATIO_DEC / DEG_PER_MOUNT_REV_DEC,
-                 angles.ra  * REDUCTION_RATIO_RA  / DEG_PER_MOUNT_REV_RA };
+        return { Dec::deg_to_revs(angles.dec), Ra::deg_to_revs(angles.ra) };
+    }
+
+    // motor revolutions needed to get from the mount position 'from' to the position 'to'
+    coord_t revolutions_between(position_t from, position_t to) {
+        return { Dec::bam_to_revs(to.dec - from.dec), Ra::bam_to_revs(to.ra - from.ra) };
+    }
+
+    // Motor revolutions of the fastest slew from 'from' to any of the mount positions which
+    // point at local coordinates 'to' (RA +- 360 or over the pole of the mount, see flip) and
+    // fit RA_LIMIT_xxx and DEC_LIMIT_xxx, 'duration_ms' is set to the estimated duration. The
+    // plain position in -90..90, 0..360 is used if none of them fits the limits.
+    coord_t revolutions_fastest(position_t from, coord_t to, float& duration_ms);
+
+    // true if the DEC axis went over the pole of the mount, i.e. its DEC is out of -90..90
+    static boolean is_flipped(position_t position) {
+        return position.dec > BAM_TURN / 4 || position.dec < -BAM_TURN / 4;
     }
 
-    coord_t revolutions_to_angle(coord_t revolutions) {
-        return { revolutions.dec * DEG_PER_MOUNT_REV_DEC / REDUCTION_RATIO_DEC,
-                 revolutions.ra  * DEG_PER_MOUNT_REV_RA  / REDUCTION_RATIO_RA };
+    // the same direction as local coordinates 'local' reached by going over the pole of the mount
+    static coord_t flip(coord_t local) {
+        return { (local.dec >= 0 ? 180 : -180) - local.dec, local.ra + 180 };
+    }
+
+    // true if the position fits RA_LIMIT_xxx and DEC_LIMIT_xxx and points at an allowed cell of 
+    // the keep-out map (positions over the pole of the mount use the cell of their direction)
+    boolean is_safe(position_t position);
+
+    // Checks positions along the slew from 'from' by motor revolutions 'revs'. Both motors turn
+    // at a similar speed, so the axis with less revolutions finishes earlier and the path is
+    // sampled with a half of the keep-out cell in revolutions of the faster moving axis.
+    boolean is_path_safe(position_t from, coord_t revs);
+
+    // Plans a fast slew from 'from' onto a sky object with global coordinates 'target' (DEC 
+    // and time dependent RA, see to_time_global_ra). The object moves while slewing, so its
+    // future position and the slew duration are iterated until the duration changes by less 
+    // than GOTO_TIME_TOLERANCE_MS, returns motor revolutions of the slew.
+    coord_t plan_slew(position_t from, coord_t target);
+
+    // motor revolutions needed to get from 'from' to the nearest equivalent of local coordinates 'to'
+    // without changing the side of the pole of the mount
+    coord_t revolutions_nearby(position_t from, coord_t to) {
+        if (is_flipped(from)) to = flip(to);
+        return { Dec::bam_to_revs((int32_t)(deg_to_bam(to.dec) - (bam_t)from.dec)),
+                 Ra::bam_to_revs((int32_t)(deg_to_bam(to.ra)  - (bam_t)from.ra)) };
+    }
+
+    // exact position of mount axes given by the balance of motor pulses
+    position_t get_local_mount_position() {
+        Dec::pulses_t dec_pulses;
+        Ra::pulses_t ra_pulses;
+        _motors.get_made_pulses(dec_pulses, ra_pulses);
+        return { Dec::pulses_to_bam(dec_pulses), Ra::pulses_to_bam(ra_pulses) };
     }
 
     inline float to_180_range(float angle) {
@@ -138,6 +229,37 @@ class MountController {
         return angle;
     }
 
+    inline float to_360_range(float angle) {
+        angle = fmod(angle, 360);
+        if (angle < 0) angle += 360;
+        return angle;
+    }
+
+    // decides whether the pole is close enough to {90, ..} or {LATITUDE, 180} to use a fast path
+    mount_type_t get_mount_type(coord_t pole) {
+        if (fabs(pole.dec - 90) <= POLE_TOLERANCE) return EQUATORIAL;
+        if (fabs(pole.dec - LATITUDE) <= POLE_TOLERANCE && 
+            fabs(to_180_range(fmod(pole.ra - 180, 360))) <= POLE_TOLERANCE) return ALTAZIMUTHAL;
+        return GENERAL;
+    }
+
+    // Moves the point given by global cartesian coordinates towards the zenith by atmospheric
+    // refraction (true to apparent position) or away from it if 'inverse' (apparent to true).
+    // The altitude is given by the dot product with _zenith and the point is then rotated in 
+    // the plane of the point and the zenith, so it is cheap (see REFRACTION_PRESSURE).
+    cartesian_t refract(cartesian_t point, boolean inverse);
+
+    // the same for global polar coordinates, which are returned as they are if the refraction is
+    // disabled or too small to change a float (so they do not go through cartesian coordinates)
+    coord_t refract(coord_t point, boolean inverse);
+
+    // refraction (rad, negative if 'inverse') of the point, zero if it is disabled, at the zenith
+    // or below float resolution, 's' and 'c' are the sine and cosine of the altitude of the point
+    float refraction_angle(cartesian_t point, boolean inverse, real_t& s, real_t& c);
+
+    // rotates the point by 'r' (rad) towards the zenith, 's' and 'c' are from refraction_angle
+    cartesian_t rotate_to_zenith(cartesian_t point, float r, real_t s, real_t c);
+
     // returns coordinates of 'point' (defined in equatorial coord. sys.) w. r. to 
     // coordinate system given by the transition matrix 'transition'
     inline coord_t polar_to_polar(coord_t point, const matrix_t& transition) {
@@ -145,10 +267,10 @@ class MountController {
     }
 
     // converts spherical coordinates with unit radius to cartesian
-    cartesian_t polar_to_cartesian(coord_t polar);
+    inline cartesian_t polar_to_cartesian(coord_t polar) { return ::polar_to_cartesian<real_t>(polar); }
 
-    // converts cartesian to spherical coordinates with unit radius
-    coord_t cartesian_to_polar(cartesian_t cartesian);
+    // converts cartesian to spherical coordinates
+    inline coord_t cartesian_to_polar(cartesian_t cartesian) { return ::cartesian_to_polar(cartesian); }
 
     // make the transition matrix which is a product of three rotations
     matrix_t make_transition_matrix(coord_t pole, float ra_offset) {
@@ -171,22 +293,47 @@ class MountController {
 
     matrix_t get_ra_transition_inverse(deg_t ra);
 
-    // Returns angular speed (DEC, RA) of a point with coordinates 'dec', 'ra' w. r. to the 
-    // coordinate system defined by the 'pole' and 'offset' at a particular time 't'. The point has 
-    // angular speed in the global coordinates 0 deg/s DEC and 'ra_speed' deg/s RA. USE ONLY FOR SMALL 
-    // TRANSFORMS NEARBY THE REAL GLOBAL POLE.
-    coord_t get_ra_speed_transform(deg_t ra_speed, float t, coord_t point, coord_t pole, deg_t ra_offset);
+    // rotations of the coordinate system around X and Y axes (used by precession & nutation)
+    matrix_t get_x_transition(deg_t angle);
+
+    matrix_t get_y_transition(deg_t angle);
+
+    // recomputes _apparent and _aberration if they are older than APPARENT_REFRESH_S
+    void update_apparent();
 
     // returns a number from standard normal distribution using transform from uniform distribution
     float random_normal();
 
+    // queues tracking segments until TRACKING_SEGMENTS_AHEAD of them wait in the motor queue
+    void update_tracking();
+
+    // queues a tracking movement from 'start_ms' to 'start_ms' + 'duration_ms' (since the start of tracking),
+    // it starts at _tracking_end_dec/ra and moves them to its end
+    void queue_tracking_segment(unsigned long start_ms, unsigned long duration_ms);
+
+    // queues a tracking movement which ends at the position of the object in 'end_ms' (since the
+    // start of tracking), it starts where the running movement ends and takes 'duration_ms'
+    void queue_tracking_correction(unsigned long end_ms, unsigned long duration_ms);
+
     boolean _is_tracking;
+    uint8_t _tracking_mode = TRACKING_MODE;
+
+    // global coordinates (DEC, RA) of the tracked object, millis at the start of the tracking
+    // and the end (millis since the start) of the last queued tracking segment
+    coord_t _tracking_target;
+    unsigned long _tracking_start_ms;
+    unsigned long _tracking_scheduled_ms;
+
+    // balance of pulses of the motors at the end of the last queued tracking segment
+    Dec::pulses_t _tracking_end_dec;
+    Ra::pulses_t _tracking_end_ra;
 
     // DEC and RA of the real mount pole, BUT! RA is 0 for points
     // on the meridian which is opposite to the local one 
     // (i.e. pointing to north) and DEC is 90 for the celestial 
     // pole as is usual (so properly aligned mount is {90, ..} for 
-    // equatorial coords. and {LATITUDE, 0} for azimuthal coords.)
+    // equatorial coords. and {LATITUDE, 180} for azimuthal coords.,
+    // the zenith is on the local meridian)
     coord_t _mount_pole;
 
     // Offset of the RA coordinate, it is dependent on the initial RA 
@@ -201,6 +348,26 @@ class MountController {
     matrix_t _transition;
     matrix_t _transition_inverse;
 
+    // J2000 -> apparent place of the date, product of precession and nutation matrices (and 
+    // the equation of equinoxes, because LST is the mean one), Earth velocity in units of c
+    // for the annual aberration and the RTC time (secondstime) for which they were computed
+    matrix_t _apparent;
+    cartesian_t _aberration;
+    uint32_t _apparent_time;
+    boolean _apparent_valid;
+
+    // specialized transforms used instead of the matrices above if the mount is not GENERAL,
+    // _ra_shift is the total RA rotation and _pole_xxx_dec describe the tilt of alt-az mount
+    mount_type_t _mount_type;
+    deg_t _ra_shift;
+    real_t _pole_sin_dec;
+    real_t _pole_cos_dec;
+
+    // zenith in global cartesian coordinates, i.e. the pole {LATITUDE, 180} of alt-az mounts
+    cartesian_t _zenith;
+
+    KeepOutMap _keep_out;
+
     MotorController& _motors;
 };
 
@@ -6,7 +6,7 @@
 #ifndef QUEUE_H
 #define QUEUE_H
 
-#include <Arduino.h>
+#include "../hal/hal.h"
 
 template<class T>
 class queue {
@@ -25,6 +25,9 @@ class queue {
     ~queue() {
       delete[] _data;  
     }
+    // the buffer is owned, so copies would free it twice
+    queue(const queue&) = delete;
+    queue& operator=(const queue&) = delete;
     inline int count();
     inline int front();
     inline int back();
@@ -0,0 +1,52 @@
+#include <math.h>
+
+#include "../hal/hal.h"
+#include "refraction.h"
+
+#define REFRACTION_TABLE_SIZE   64
+#define REFRACTION_MIN_ALT      -1.0         // altitude of the first table entry
+#define REFRACTION_SQRT_RANGE   9.53939201   // sqrt(90 - REFRACTION_MIN_ALT)
+#define REFRACTION_ITERATIONS   3            // each iteration shrinks the error at least 6 times
+
+// converts table entries (0.1 arc second for 1010 mbar and 10 deg C) to degrees 
+static const float refraction_scale = REFRACTION_PRESSURE / 1010.0 * 283.0 / (273.0 + REFRACTION_TEMPERATURE) / 36000.0;
+
+// refraction (0.1 arc second) for true altitudes (sqrt(91) * i / 63)^2 - 1 degrees
+static const uint16_t refraction_table[REFRACTION_TABLE_SIZE] PROGMEM = {
+    23277, 23138, 22718, 22011, 21022, 19776, 18329, 16758,
+    15144, 13565, 12075, 10710, 9486, 8405, 7458, 6635,
+    5921, 5301, 4763, 4296, 3887, 3530, 3216, 2939,
+    2693, 2475, 2280, 2105, 1948, 1806, 1677, 1559,
+    1452, 1354, 1264, 1180, 1103, 1032, 965, 903,
+    844, 789, 738, 689, 643, 599, 557, 517,
+    478, 441, 405, 371, 337, 304, 272, 241,
+    210, 180, 150, 120, 90, 60, 29, 0
+};
+
+float refraction_true_to_apparent(float altitude) {
+
+    if (altitude >= 90) return 0;
+
+    // objects below the table are not visible anyway, use the value at its start
+    float u = 0;
+    if (altitude > REFRACTION_MIN_ALT) {
+        u = sqrt(altitude - REFRACTION_MIN_ALT) * ((REFRACTION_TABLE_SIZE - 1) / REFRACTION_SQRT_RANGE);
+    }
+
+    uint8_t i = min((uint8_t)u, (uint8_t)(REFRACTION_TABLE_SIZE - 2));
+    float low  = pgm_read_word(&refraction_table[i]);
+    float high = pgm_read_word(&refraction_table[i + 1]);
+
+    return (low + (high - low) * (u - i)) * refraction_scale;
+}
+
+float refraction_apparent_to_true(float altitude) {
+
+    // the true altitude h solves h + R(h) = altitude, R changes slowly, so iterate h = altitude - R(h)
+    float refraction = refraction_true_to_apparent(altitude);
+    for (uint8_t i = 0; i < REFRACTION_ITERATIONS; ++i) {
+        refraction = refraction_true_to_apparent(altitude - refraction);
+    }
+
+    return refraction;
+}
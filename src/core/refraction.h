@@ -0,0 +1,24 @@
+#ifndef REFRACTION_H
+#define REFRACTION_H
+
+#include <stdint.h>
+
+#include "../config.h"
+
+// Atmospheric refraction by the Saemundsson's formula (true altitude h to apparent, arc min.)
+//
+//      R = 1.02 / tan(h + 10.3 / (h + 5.11)) * P / 1010 * 283 / (273 + T)
+//
+// where P and T are REFRACTION_PRESSURE and REFRACTION_TEMPERATURE. The formula is tabulated
+// by 64 values keyed by sqrt(h + 1), so the table is dense near the horizon, where refraction
+// changes quickly, and linear interpolation keeps the error below 2 arc seconds (which is the
+// precision of the formula itself). The opposite direction (the one of Bennett's formula) is
+// solved by a few iterations over the same table.
+
+// refraction (deg) which must be added to the true altitude (deg) to get the apparent one
+float refraction_true_to_apparent(float altitude);
+
+// refraction (deg) which must be subtracted from the apparent altitude (deg) to get the true one
+float refraction_apparent_to_true(float altitude);
+
+#endif
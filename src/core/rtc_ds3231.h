@@ -1,10 +1,8 @@
 #ifndef RTC_DS3231_H
 #define RTC_DS3231_H
 
-#include <RTClib.h>
-#include <Time.h>
-
 #include "../config.h"
+#include "../hal/hal.h"
 #include "clock.h"
 
 class RtcDS3231 : public Clock {
@@ -15,24 +13,24 @@ class RtcDS3231 : public Clock {
 
             if (!_rtc.begin()) {
                 #ifdef DEBUG_TIME
-                      Serial.println("Cannot find DS3231");
+                      LOG(RTC_MISSING);
                 #endif
-                while(true);
+                while(true) Log::drain(Serial);
             }
             
-            set_time(_rtc.now());
+            set_time_and_LST(_rtc.now());
         }
 
         void sync(const DateTime& dt) override { 
               _rtc.adjust(dt);
-              set_time(dt);
+              set_time_and_LST(dt);
         };
 
     private: 
 
-        inline void set_time(const DateTime& dt) {
-            Clock::_time.adjust(dt);
-            Clock::_local_siderial_time_offset = Clock::compute_LST_offset();
+        inline void set_time_and_LST(const DateTime& dt) {
+            Clock::set_time(dt);
+            Clock::set_LST(Clock::compute_LST());
         }
 
         RTC_DS3231 _rtc;
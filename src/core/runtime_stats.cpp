@@ -0,0 +1,62 @@
+#include "runtime_stats.h"
+
+RuntimeStats::stats_t RuntimeStats::_stats = {};
+unsigned long RuntimeStats::_last_loop_us = 0;
+
+void RuntimeStats::record_loop() {
+
+    unsigned long now = micros();
+    unsigned long period = now - _last_loop_us;
+    _last_loop_us = now;
+
+    // the first loop after a reset has no period
+    if (_stats.loop_count++ > 0 && period > _stats.loop_max_us) _stats.loop_max_us = period;
+}
+
+void RuntimeStats::record_state(uint8_t state, unsigned long start_us) {
+
+    if (state >= STATS_STATES) return;
+
+    unsigned long duration = micros() - start_us;
+    if (duration > _stats.state_max_us[state]) _stats.state_max_us[state] = duration;
+    _stats.state_total_us[state] += duration;
+}
+
+RuntimeStats::stats_t RuntimeStats::get() {
+    cli();
+    stats_t stats = _stats;
+    sei();
+    stats.ram_free = hal::ram_free();
+    stats.ram_free_min = hal::ram_free_min();
+    return stats;
+}
+
+void RuntimeStats::reset() {
+    cli();
+    _stats = {};
+    sei();
+}
+
+void RuntimeStats::print(Print& out) {
+
+    stats_t stats = get();
+
+    out.println(F("Runtime stats:"));
+    out.print(F("  ISR count:        ")); out.println(stats.isr_count);
+    out.print(F("  ISR max cycles:   ")); out.println(stats.isr_max_cycles);
+    out.print(F("  ISR max latency:  ")); out.println(stats.isr_max_latency);
+    out.print(F("  ISR late ticks:   ")); out.println(stats.isr_late);
+    out.print(F("  ISR missed ticks: ")); out.println(stats.isr_missed);
+    out.print(F("  queue max:        ")); out.println(stats.queue_max);
+    out.print(F("  loop count:       ")); out.println(stats.loop_count);
+    out.print(F("  loop max (us):    ")); out.println(stats.loop_max_us);
+    out.print(F("  RAM free:         ")); out.println(stats.ram_free);
+    out.print(F("  RAM free min:     ")); out.println(stats.ram_free_min);
+
+    for (uint8_t i = 0; i < STATS_STATES; ++i) {
+        if (stats.state_max_us[i] == 0) continue;
+        out.print(F("  state ")); out.print(i);
+        out.print(F(" max (us): ")); out.print(stats.state_max_us[i]);
+        out.print(F(", total (ms): ")); out.println((unsigned long)(stats.state_total_us[i] / 1000));
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef RUNTIME_STATS_H
+#define RUNTIME_STATS_H
+
+#include "../config.h"
+#include "../hal/hal.h"
+
+#define STATS_STATES    10  // number of states of Control (see Control::State)
+
+// Counters of the step timer interrupt and the main loop. They cost a few cycles, so they are
+// collected always (not just in DEBUG builds) and printed over serial when the character
+// STATS_REQUEST_CHAR is received, so timing regressions can be seen on a working tracker.
+class RuntimeStats {
+
+    public:
+
+        struct stats_t {
+            uint32_t isr_count;                 // step timer interrupts
+            uint16_t isr_max_cycles;            // the longest interrupt in CPU cycles
+            uint16_t isr_max_latency;           // the longest delay of an interrupt after its tick (CPU cycles)
+            uint32_t isr_late;                  // ticks which came before the previous interrupt ended
+            uint32_t isr_missed;                // ticks lost because an interrupt ended more than two periods after its tick
+            uint8_t  queue_max;                 // high-water mark of the motor command queue
+            uint32_t loop_count;                // calls of Control::update
+            uint32_t loop_max_us;               // the longest period between two calls of Control::update
+            uint32_t state_max_us[STATS_STATES];  // the longest run of the handler of a Control state
+            uint64_t state_total_us[STATS_STATES];  // time spent in the handler of a Control state
+            uint16_t ram_free;                  // bytes between the heap and the stack (not reset)
+            uint16_t ram_free_min;              // the fewest free bytes since the start (not reset)
+        };
+
+        // called by the interrupt service rutine with its latency (from the tick to its entry, e.g.
+        // behind cli() of the main loop), its duration and the period of the timer (cycles)
+        static inline void record_isr(uint16_t latency, uint16_t cycles, uint16_t period) {
+            ++_stats.isr_count;
+            if (cycles > _stats.isr_max_cycles) _stats.isr_max_cycles = cycles;
+            if (latency > _stats.isr_max_latency) _stats.isr_max_latency = latency;
+            uint16_t since_tick = latency + cycles;
+            if (since_tick < period) return;
+            // a single tick which came meanwhile waits as the pending interrupt, others are lost
+            ++_stats.isr_late;
+            _stats.isr_missed += since_tick / period - 1;
+        }
+
+        static inline void record_queue(uint8_t count) {
+            if (count > _stats.queue_max) _stats.queue_max = count;
+        }
+
+        // called at the start of every main loop
+        static void record_loop();
+
+        // called after the handler of the 'state' which started at 'start_us' (micros)
+        static void record_state(uint8_t state, unsigned long start_us);
+
+        // returns a consistent copy of the counters with the free RAM (scanning it takes a few ms)
+        static stats_t get();
+
+        static void reset();
+
+        // prints the counters in a human readable form
+        static void print(Print& out);
+
+    private:
+
+        static stats_t _stats;
+        static unsigned long _last_loop_us;
+};
+
+#endif
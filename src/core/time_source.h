@@ -0,0 +1,61 @@
+#ifndef TIME_SOURCE_H
+#define TIME_SOURCE_H
+
+#include "../hal/hal.h"
+
+// Source of the time of Clock (the calendar time, LST and timing of the user interface and camera),
+// the step generator and the tracking corrections always run on the board time of the step timer.
+class TimeSource {
+
+    public:
+
+        virtual unsigned long millis() = 0;
+        virtual unsigned long micros() = 0;
+};
+
+// time of the board, i.e. millis() and micros() of the Arduino core, the clock of the firmware
+class BoardTime : public TimeSource {
+
+    public:
+
+        unsigned long millis() override { return ::millis(); }
+        unsigned long micros() override { return ::micros(); }
+};
+
+// Time which is stepped explicitly or runs at an integer multiple of the board time, so the
+// LST, display blinking, keypad holds or camera exposures can be fast forwarded or frozen.
+// The mount tracks with the board time, so a rate other than 1 is meant for bench testing
+// with motors standing still (the positions would not match the sky otherwise).
+class VirtualTime : public TimeSource {
+
+    public:
+
+        // 0 freezes the time, it is advanced only by step() then
+        void set_rate(uint16_t rate) {
+            advance();
+            _rate = rate;
+        }
+
+        void step(uint32_t us) {
+            advance();
+            _micros += us;
+        }
+
+        unsigned long millis() override { advance(); return _micros / 1000; }
+        unsigned long micros() override { advance(); return _micros; }
+
+    private:
+
+        // adds the board time elapsed from the last call multiplied by the rate
+        void advance() {
+            unsigned long now = ::micros();
+            _micros += (uint64_t)(now - _anchor) * _rate;
+            _anchor = now;
+        }
+
+        uint64_t      _micros = 0;
+        unsigned long _anchor = ::micros();
+        uint16_t      _rate = 1;
+};
+
+#endif
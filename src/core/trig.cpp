@@ -0,0 +1,164 @@
+#include <math.h>
+
+#include "../hal/hal.h"
+#include "trig.h"
+
+#define TRIG_TABLE_BITS         8           // quarter wave is split into 2^TRIG_TABLE_BITS parts
+#define TRIG_RESIDUAL_BITS      22          // 30 - TRIG_TABLE_BITS
+#define TRIG_HALF_PI_Q30        1686629713L // pi / 2 in Q30, converts residual BAM to radians
+#define TRIG_CORDIC_ITERATIONS  24
+#define TRIG_CORDIC_GAIN        0.607252935 // inverse of the CORDIC gain after 24 iterations
+
+// sin(i * pi / 512) in Q30 format, the last entry is needed for cosine of zero angle
+static const int32_t sin_table[(1 << TRIG_TABLE_BITS) + 1] PROGMEM = {
+    0, 6588356, 13176464, 19764076, 26350943, 32936819,
+    39521455, 46104602, 52686014, 59265442, 65842639, 72417357,
+    78989349, 85558366, 92124163, 98686491, 105245103, 111799753,
+    118350194, 124896179, 131437462, 137973796, 144504935, 151030634,
+    157550647, 164064728, 170572633, 177074115, 183568930, 190056834,
+    196537583, 203010932, 209476638, 215934457, 222384147, 228825464,
+    235258165, 241682010, 248096755, 254502159, 260897982, 267283981,
+    273659918, 280025552, 286380643, 292724951, 299058239, 305380268,
+    311690799, 317989595, 324276419, 330551034, 336813204, 343062693,
+    349299266, 355522689, 361732726, 367929144, 374111709, 380280190,
+    386434353, 392573967, 398698801, 404808624, 410903207, 416982319,
+    423045732, 429093217, 435124548, 441139496, 447137835, 453119340,
+    459083786, 465030947, 470960600, 476872522, 482766489, 488642281,
+    494499676, 500338453, 506158392, 511959275, 517740883, 523502998,
+    529245404, 534967884, 540670223, 546352205, 552013618, 557654248,
+    563273883, 568872310, 574449320, 580004702, 585538248, 591049748,
+    596538995, 602005783, 607449906, 612871159, 618269338, 623644239,
+    628995660, 634323400, 639627258, 644907034, 650162530, 655393548,
+    660599890, 665781362, 670937767, 676068911, 681174602, 686254647,
+    691308855, 696337036, 701339000, 706314559, 711263525, 716185713,
+    721080937, 725949013, 730789757, 735602987, 740388522, 745146182,
+    749875788, 754577161, 759250125, 763894504, 768510122, 773096806,
+    777654384, 782182683, 786681534, 791150767, 795590213, 799999706,
+    804379079, 808728167, 813046808, 817334838, 821592095, 825818421,
+    830013654, 834177638, 838310216, 842411232, 846480531, 850517961,
+    854523370, 858496606, 862437520, 866345964, 870221790, 874064853,
+    877875009, 881652112, 885396022, 889106597, 892783698, 896427186,
+    900036924, 903612776, 907154608, 910662286, 914135678, 917574653,
+    920979082, 924348837, 927683790, 930983817, 934248793, 937478595,
+    940673101, 943832191, 946955747, 950043650, 953095785, 956112036,
+    959092290, 962036435, 964944360, 967815955, 970651112, 973449725,
+    976211688, 978936898, 981625251, 984276646, 986890984, 989468165,
+    992008094, 994510675, 996975812, 999403415, 1001793390, 1004145648,
+    1006460100, 1008736660, 1010975242, 1013175761, 1015338134, 1017462281,
+    1019548121, 1021595575, 1023604567, 1025575020, 1027506862, 1029400018,
+    1031254418, 1033069992, 1034846671, 1036584389, 1038283080, 1039942680,
+    1041563127, 1043144360, 1044686319, 1046188946, 1047652185, 1049075980,
+    1050460278, 1051805027, 1053110176, 1054375676, 1055601479, 1056787540,
+    1057933813, 1059040255, 1060106826, 1061133483, 1062120190, 1063066909,
+    1063973603, 1064840240, 1065666786, 1066453210, 1067199483, 1067905576,
+    1068571464, 1069197120, 1069782521, 1070327646, 1070832474, 1071296985,
+    1071721163, 1072104991, 1072448455, 1072751542, 1073014240, 1073236540,
+    1073418433, 1073559913, 1073660973, 1073721611, 1073741824,
+};
+
+// atan(2^-i) as binary angles
+static const uint32_t atan_table[TRIG_CORDIC_ITERATIONS] PROGMEM = {
+    536870912UL, 316933406UL, 167458907UL, 85004756UL, 42667331UL, 21354465UL,
+    10679838UL, 5340245UL, 2670163UL, 1335087UL, 667544UL, 333772UL,
+    166886UL, 83443UL, 41722UL, 20861UL, 10430UL, 5215UL,
+    2608UL, 1304UL, 652UL, 326UL, 163UL, 81UL,
+};
+
+static inline int32_t mul_q30(int32_t a, int32_t b) {
+    return ((int64_t)a * b) >> 30;
+}
+
+void bam_sincos(bam_t angle, int32_t& sine, int32_t& cosine) {
+
+    // split the angle into quadrant, table index and residual angle
+    uint8_t quadrant = angle >> 30;
+    uint16_t index = (angle >> TRIG_RESIDUAL_BITS) & ((1 << TRIG_TABLE_BITS) - 1);
+    int32_t residual = angle & ((1UL << TRIG_RESIDUAL_BITS) - 1);
+
+    int32_t sin_a = pgm_read_dword(&sin_table[index]);
+    int32_t cos_a = pgm_read_dword(&sin_table[(1 << TRIG_TABLE_BITS) - index]);
+
+    // the residual is less than 0.36 deg, so sin(d) ~ d - d^3/6 and cos(d) ~ 1 - d^2/2
+    int32_t d = ((int64_t)residual * TRIG_HALF_PI_Q30) >> 30;
+    int32_t d_sq = mul_q30(d, d);
+    int32_t sin_d = d - mul_q30(d_sq, d) / 6;
+    int32_t cos_d = TRIG_ONE - d_sq / 2;
+
+    int32_t s = mul_q30(sin_a, cos_d) + mul_q30(cos_a, sin_d);
+    int32_t c = mul_q30(cos_a, cos_d) - mul_q30(sin_a, sin_d);
+
+    switch (quadrant) {
+        case 0: sine =  s; cosine =  c; break;
+        case 1: sine =  c; cosine = -s; break;
+        case 2: sine = -s; cosine = -c; break;
+        case 3: sine = -c; cosine =  s; break;
+    }
+}
+
+// CORDIC in vectoring mode, rotates (x, y) onto positive x half-axis and returns the 
+// angle of rotation, x must be positive and x, y must be less than 2^30 in absolute value
+static bam_t cordic_vectoring(int32_t& x, int32_t& y) {
+
+    bam_t angle = 0;
+
+    for (uint8_t i = 0; i < TRIG_CORDIC_ITERATIONS; ++i) {
+        int32_t dx = y >> i;
+        int32_t dy = x >> i;
+        bam_t da = pgm_read_dword(&atan_table[i]);
+        if (y > 0) { x += dx; y -= dy; angle += da; }
+        else       { x -= dx; y += dy; angle -= da; }
+    }
+
+    return angle;
+}
+
+bam_t bam_atan2(int32_t y, int32_t x) {
+
+    if (x == 0 && y == 0) return 0;
+
+    // normalize so that the larger coordinate has 29 significant bits (leaves a room for 
+    // the CORDIC gain), this keeps the precision for short vectors
+    while (labs(x) < (1L << 28) && labs(y) < (1L << 28)) { x <<= 1; y <<= 1; }
+    while (labs(x) >= (1L << 29) || labs(y) >= (1L << 29)) { x >>= 1; y >>= 1; }
+
+    // rotate by 180 degrees to reach the right half-plane which CORDIC can handle
+    bam_t angle = 0;
+    if (x < 0) { x = -x; y = -y; angle = 1UL << 31; }
+
+    return angle + cordic_vectoring(x, y);
+}
+
+void fast_sincos(float deg, float& sine, float& cosine) {
+    int32_t s, c;
+    bam_sincos(deg_to_bam(deg), s, c);
+    sine = s / (float)TRIG_ONE;
+    cosine = c / (float)TRIG_ONE;
+}
+
+float fast_atan2(float y, float x, float* length) {
+
+    if (x == 0 && y == 0) {
+        if (length) *length = 0;
+        return 0;
+    }
+
+    // convert to fixed point with the larger coordinate scaled to 29 bits
+    int exponent;
+    frexp(fabs(x) > fabs(y) ? x : y, &exponent);
+    int32_t x_fixed = ldexp(x, 29 - exponent);
+    int32_t y_fixed = ldexp(y, 29 - exponent);
+
+    bam_t angle = 0;
+    if (x_fixed < 0) { x_fixed = -x_fixed; y_fixed = -y_fixed; angle = 1UL << 31; }
+    angle += cordic_vectoring(x_fixed, y_fixed);
+
+    if (length) *length = ldexp(x_fixed * TRIG_CORDIC_GAIN, exponent - 29);
+    return bam_to_signed_deg(angle);
+}
+
+float fast_asin(float z) {
+    if (z >= 1.0f) return 90.0f;
+    if (z <= -1.0f) return -90.0f;
+    // the product form avoids cancellation of 1 - z^2 near the poles
+    return fast_atan2(z, sqrt((1.0f - z) * (1.0f + z)));
+}
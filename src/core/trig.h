@@ -0,0 +1,38 @@
+#ifndef TRIG_H
+#define TRIG_H
+
+#include <stdint.h>
+
+#include "angle.h"
+
+// Fixed point trigonometry which avoids soft-float sin/cos/asin/atan2 of AVR (thousands
+// of cycles each). Enable it for MountController coordinate conversions by FAST_TRIG.
+//
+//  - sines and cosines are interpolated from a quarter wave table of 256 values by the sum
+//    formula with 3rd order terms of the residual angle, so the error is given just by Q30
+//    rounding, i.e. below 5e-9 (0.001 arc second)
+//  - arc tangents are computed by 24 iterations of CORDIC in vectoring mode with normalized
+//    Q29 inputs, so the error is below 1.5e-7 rad (0.03 arc second, the last rotation of
+//    atan(2^-23) plus rounding) for any vector length
+//  - arc sines are reduced to arc tangents, so they have the same precision, even near +-1
+//  - float interfaces add rounding of float degrees (up to 0.06 arc second near 180 deg)
+
+#define TRIG_ONE            1073741824L   // 1.0 in Q30 format
+
+// sine and cosine of a binary angle in Q30 format
+void bam_sincos(bam_t angle, int32_t& sine, int32_t& cosine);
+
+// angle of the vector (x, y) as a signed binary angle, the scale of x and y does not matter
+bam_t bam_atan2(int32_t y, int32_t x);
+
+// sine and cosine of an angle in degrees
+void fast_sincos(float deg, float& sine, float& cosine);
+
+// arc tangent of y/x in degrees in range -180..180, the length of the vector can be
+// returned in 'length' (just a byproduct of CORDIC, so it is cheap)
+float fast_atan2(float y, float x, float* length = nullptr);
+
+// arc sine in degrees in range -90..90
+float fast_asin(float z);
+
+#endif
@@ -0,0 +1,36 @@
+#ifdef ARDUINO
+
+#include "hal_avr.h"
+
+#define RAM_PAINT   0xC5    // unlikely to be written by the stack or heap
+
+extern uint8_t _end;        // the end of static variables, the heap starts here
+extern uint8_t __stack;     // the last byte of RAM, the stack grows down from here
+extern char* __brkval;      // the end of the heap (null until the first allocation)
+
+// Paints the whole free RAM before the constructors of global objects run, the code of .init3
+// runs inline during the startup (the stack is empty yet), so the function is naked.
+void paint_ram() __attribute__((naked, used, section(".init3")));
+
+void paint_ram() {
+    for (uint8_t* p = &_end; p <= &__stack; ++p) *p = RAM_PAINT;
+}
+
+namespace hal {
+
+    uint16_t _timer0_phase = 0;
+
+    uint16_t ram_free() {
+        uint8_t* heap_end = __brkval ? (uint8_t*)__brkval : &_end;
+        return (uint8_t*)SP - heap_end;
+    }
+
+    uint16_t ram_free_min() {
+        uint8_t* p = __brkval ? (uint8_t*)__brkval : &_end;
+        uint16_t free = 0;
+        for (; p <= &__stack && *p == RAM_PAINT; ++p) ++free;
+        return free;
+    }
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef HAL_AVR_H
+#define HAL_AVR_H
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <SPI.h>
+#include <SD.h>
+#include <Wire.h>
+#include <LiquidCrystal.h>
+#include <RTClib.h>
+
+#include "../../config.h"
+
+// interrupt service routine of the step timer
+#define HAL_TIMER_ISR ISR(TIMER5_COMPA_vect)
+
+// hal::cycle_counter wraps every 16384 CPU cycles (1 ms), mask differences of its values by this
+#define HAL_CYCLE_MASK  0x3FFF
+
+namespace hal {
+
+    // Timer0 (millis, prescaler 64) in CPU cycles when the step timer was started
+    extern uint16_t _timer0_phase;
+
+    inline uint8_t motors_read() { return MOTORS_PORT; }
+
+    inline void motors_write(uint8_t value) { MOTORS_PORT = value; }
+
+    inline void motors_toggle(uint8_t mask) { MOTORS_PORT ^= mask; }
+
+    inline void motors_clear(uint8_t mask) { MOTORS_PORT &= ~mask; }
+
+    // sets the pins of the mask as outputs with LOW level
+    inline void motors_output(uint8_t mask) {
+        MOTORS_DDR |= mask;
+        MOTORS_PORT &= ~mask;
+    }
+
+    // starts the step timer, HAL_TIMER_ISR is then called every 'top' CPU cycles
+    inline void timer_start(uint16_t top) {
+
+        // Timer/Counter Control Register: set Fast PWM mode
+        TCCR5A = 0x23 ; // || set mode 7 (Fast PWM) with
+        TCCR5B = 0x09 ; // || prescaler 1 (no prescaling)
+
+        // Output Compare Register: set interrupt frequency
+        OCR5A = top - 1;
+        OCR5B = 0;
+
+        // Timer/Counter Interrupt Mask Register: set interrupt TIMERx_COMPA_vect
+        TIMSK5 |= (1 << OCIE5A);
+
+        // the phase of Timer0 against the step timer for cycle_counter
+        uint8_t sreg = SREG;
+        cli();
+        TCNT5 = 0;
+        _timer0_phase = (uint16_t)TCNT0 << 6;
+        SREG = sreg;
+
+        #ifdef DEBUG
+            Serial.println(F("TimerX initialized."));
+            Serial.print(F("  TCCRxA: ")); Serial.println(TCCR5A, BIN);
+            Serial.print(F("  TCCRxB: ")); Serial.println(TCCR5B, BIN);
+            Serial.print(F("  TIMSKx: ")); Serial.println(TIMSK5, BIN);
+        #endif
+    }
+
+    // Counter of CPU cycles made of the timers which already run, so no other timer (and its PWM
+    // pins) is taken: Timer0 overflows every 16 periods of the step timer (16384 cycles) and tells
+    // which period it is to 64 cycles, TCNT5 then gives the exact cycle in the period (1024 cycles
+    // in mode 7).
+    inline uint16_t cycle_counter() {
+        uint8_t sreg = SREG;
+        cli();
+        uint16_t step = TCNT5;
+        uint16_t coarse = ((uint16_t)TCNT0 << 6) - _timer0_phase;
+        SREG = sreg;
+        return (((coarse - step + 512) & 0x3C00) + step) & HAL_CYCLE_MASK;
+    }
+
+    // called when a new movement starts, resets Timer1 counter as the firmware always did
+    inline void timer_restart() { TCNT1 = 0; }
+
+    // cycles since the last tick of the step timer, i.e. the latency of HAL_TIMER_ISR at its entry
+    inline uint16_t timer_count() { return TCNT5; }
+
+    // bytes between the heap and the stack now
+    uint16_t ram_free();
+
+    // the fewest bytes between the heap and the stack since the start (the RAM is painted
+    // at the start and the bytes which were not overwritten are counted, it takes a few ms)
+    uint16_t ram_free_min();
+
+    inline uint8_t eeprom_read(uint16_t address) { return EEPROM.read(address); }
+
+    inline void eeprom_update(uint16_t address, uint8_t value) { EEPROM.update(address, value); }
+
+    using File = ::File;
+
+    inline bool storage_begin() { return SD.begin(SD_CS); }
+
+    inline File storage_open(const char* path) { return SD.open(path); }
+
+    inline void ir_begin() { pinMode(KEYPAD_IR_PIN, INPUT); }
+
+    // returns true during a pulse of the IR receiver (its output is active low)
+    inline bool ir_mark() { return !(KEYPAD_IR_PINS & (1 << KEYPAD_IR_BIT)); }
+
+    using CharLcd = LiquidCrystal;
+}
+
+#endif
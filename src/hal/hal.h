@@ -0,0 +1,30 @@
+#ifndef HAL_H
+#define HAL_H
+
+// Thin hardware abstraction layer, the core and control talk to the board only through it:
+//
+//   Arduino core      millis, micros, delay, pins, cli/sei, Serial, PROGMEM, ...
+//   motors port       hal::motors_read, hal::motors_write, hal::motors_toggle, hal::motors_clear,
+//                     hal::motors_output (MOTORS_PORT and MOTORS_DDR on the Mega)
+//   step timer        hal::timer_start, hal::timer_restart, hal::timer_count and HAL_TIMER_ISR
+//                     (Timer5 compare A)
+//   cycle counter     hal::cycle_counter, HAL_CYCLE_MASK (Timer0 and Timer5)
+//   free RAM          hal::ram_free, hal::ram_free_min (stack painting)
+//   EEPROM            hal::eeprom_read, hal::eeprom_update
+//   block storage     hal::storage_begin, hal::storage_open, hal::File (SD card)
+//   IR input          hal::ir_begin, hal::ir_mark (KEYPAD_IR_PIN)
+//   character LCD     hal::CharLcd (LiquidCrystal)
+//   real time clock   DateTime, TimeSpan, RTC_Millis, RTC_DS3231 (RTClib)
+//
+// The AVR backend maps it directly to registers and libraries of the Mega, so the firmware
+// compiles to the same code as without it. The native backend emulates the board on a
+// workstation with virtual time (see hal/native/hal_native.h), CMakeLists.txt builds the core
+// and control with it into a library.
+
+#ifdef ARDUINO
+    #include "avr/hal_avr.h"
+#else
+    #include "native/hal_native.h"
+#endif
+
+#endif
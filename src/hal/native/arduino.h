@@ -0,0 +1,124 @@
+#ifndef HAL_NATIVE_ARDUINO_H
+#define HAL_NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <type_traits>
+
+// Subset of the Arduino core API used by the firmware, time is virtual (see hal_native.h)
+
+#define F_CPU           16000000UL
+
+#define HIGH            1
+#define LOW             0
+#define INPUT           0
+#define OUTPUT          1
+
+#define DEC             10
+#define HEX             16
+#define OCT             8
+#define BIN             2
+
+#define PI              3.1415926535897932384626433832795
+#define DEG_TO_RAD      0.017453292519943295769236907684886
+#define RAD_TO_DEG      57.295779513082320876798154814105
+
+// pins of port K of the Mega (MOTORS_PORT)
+#define PK0             0
+#define PK1             1
+#define PK2             2
+#define PK3             3
+#define PK4             4
+#define PK5             5
+#define PK6             6
+#define PK7             7
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define PSTR(s)                 (s)
+#define pgm_read_byte(addr)     (*(const uint8_t*)(addr))
+#define pgm_read_word(addr)     (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr)    (*(const uint32_t*)(addr))
+#define pgm_read_float(addr)    (*(const float*)(addr))
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// the result is a value, the arguments are copies (a reference to them would dangle)
+template <class T, class U>
+inline typename std::common_type<T, U>::type min(T a, U b) { return b < a ? b : a; }
+
+template <class T, class U>
+inline typename std::common_type<T, U>::type max(T a, U b) { return a < b ? b : a; }
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// interrupts of the emulated board, the step timer interrupt is held pending while disabled
+void cli();
+void sei();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+long random(long upper);
+long random(long lower, long upper);
+void randomSeed(unsigned long seed);
+
+char* itoa(int value, char* buffer, int base);
+char* dtostrf(double value, signed char width, unsigned char precision, char* buffer);
+
+class Print {
+
+    public:
+
+        virtual ~Print() {}
+
+        virtual size_t write(uint8_t c) = 0;
+        size_t write(const char* str) { return str ? write((const uint8_t*)str, strlen(str)) : 0; }
+        virtual size_t write(const uint8_t* buffer, size_t size);
+
+        size_t print(const __FlashStringHelper* str) { return write(reinterpret_cast<const char*>(str)); }
+        size_t print(const char* str) { return write(str); }
+        size_t print(char c) { return write((uint8_t)c); }
+        size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+        size_t print(int value, int base = DEC) { return print((long)value, base); }
+        size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+        size_t print(long value, int base = DEC);
+        size_t print(unsigned long value, int base = DEC);
+        size_t print(double value, int digits = 2);
+
+        size_t println() { return write("\r\n"); }
+        template <class T> size_t println(T value) { return print(value) + println(); }
+        template <class T> size_t println(T value, int format) { return print(value, format) + println(); }
+};
+
+// serial line of the emulated board, output goes to stdout, input is empty
+class HardwareSerial : public Print {
+
+    public:
+
+        void begin(unsigned long) {}
+        int available() { return 0; }
+        int read() { return -1; }
+        int availableForWrite() { return 63; }  // the transmit buffer of the Mega is never full
+        void flush() {}
+
+        using Print::write;
+        size_t write(uint8_t c) override;
+};
+
+extern HardwareSerial Serial;
+
+#endif
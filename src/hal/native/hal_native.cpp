@@ -0,0 +1,283 @@
+#ifndef ARDUINO
+
+#include "hal_native.h"
+
+#include "../../config.h"
+
+void hal_timer_isr() __attribute__((weak));
+
+namespace hal {
+
+    namespace native {
+
+        volatile uint8_t motors_port = 0;
+        volatile uint8_t motors_ddr = 0;
+
+        void (*motors_changed)(uint8_t port) = nullptr;
+        void (*lcd_changed)(bool cleared) = nullptr;
+
+        static uint64_t _cycles = 0;
+        static uint64_t _next_compare = 0;
+        static uint16_t _timer_top = 0;
+
+        static bool _interrupts = true;
+        static bool _in_interrupt = false;
+        static bool _pending = false;
+
+        static char _storage_root[256] = "SD";
+
+        static uint32_t _ir_code = 0;
+        static bool _ir_held = false;
+        static uint64_t _ir_press_cycles = 0;
+        static uint64_t _ir_release_cycles = 0;
+
+        static uint8_t _eeprom[EEPROM_SIZE];
+        static bool _eeprom_erased = false;
+
+        static uint8_t _pins[70];
+
+        static void run_interrupt() {
+            _pending = false;
+            if (!hal_timer_isr) return;
+            _in_interrupt = true;
+            hal_timer_isr();
+            _in_interrupt = false;
+        }
+
+        void advance_micros(uint32_t us) {
+
+            uint64_t end = _cycles + (uint64_t)us * (F_CPU / 1000000);
+
+            while (_timer_top != 0 && _next_compare <= end) {
+                _cycles = _next_compare;
+                _next_compare += _timer_top;
+                if (_interrupts && !_in_interrupt) run_interrupt();
+                else _pending = true;
+            }
+
+            _cycles = end;
+        }
+
+        uint64_t cycles() { return _cycles; }
+
+        void set_storage_root(const char* path) {
+            strncpy(_storage_root, path, sizeof(_storage_root) - 1);
+        }
+
+        void ir_press(uint32_t code) {
+            _ir_code = code;
+            _ir_held = true;
+            _ir_press_cycles = _cycles;
+        }
+
+        void ir_release() {
+            if (!_ir_held) return;
+            _ir_held = false;
+            _ir_release_cycles = _cycles;
+        }
+
+        // level of the NEC signal 't' cycles after the start of a frame, the frame of the key
+        // if 'data', otherwise a repeat frame
+        static bool ir_frame_mark(uint64_t t, bool data) {
+
+            const uint64_t bit = F_CPU / 1000000 * 5625 / 10;   // 562.5 us
+
+            if (t < 16 * bit) return true;                      // leader pulse
+            t -= 16 * bit;
+
+            if (!data) return t >= 4 * bit && t < 5 * bit;      // space and the stop pulse
+            if (t < 8 * bit) return false;
+            t -= 8 * bit;
+
+            // bits from the most significant one, then the stop pulse
+            for (int8_t i = 31; i >= -1; --i) {
+                if (t < bit) return true;
+                if (i < 0) return false;
+                uint64_t length = bit * ((_ir_code >> i) & 1 ? 4 : 2);
+                if (t < length) return false;
+                t -= length;
+            }
+            return false;
+        }
+
+        uint8_t* eeprom() {
+            if (!_eeprom_erased) {
+                memset(_eeprom, 0xFF, sizeof(_eeprom));
+                _eeprom_erased = true;
+            }
+            return _eeprom;
+        }
+    }
+
+    void timer_start(uint16_t top) {
+        native::_timer_top = top;
+        native::_next_compare = native::_cycles + top;
+    }
+
+    uint32_t File::size() {
+        if (!_file) return 0;
+        long position = ftell(_file);
+        fseek(_file, 0, SEEK_END);
+        long size = ftell(_file);
+        fseek(_file, position, SEEK_SET);
+        return size;
+    }
+
+    bool storage_begin() { return true; }
+
+    File storage_open(const char* path) {
+        char full_path[sizeof(native::_storage_root) + 64];
+        snprintf(full_path, sizeof(full_path), "%s/%s", native::_storage_root, path[0] == '/' ? path + 1 : path);
+        const char* name = strrchr(path, '/');
+        return File(fopen(full_path, "rb"), name ? name + 1 : path);
+    }
+
+    // frames start every 108 ms while the key is held, the first one carries the key
+    bool ir_mark() {
+        if (native::_ir_code == 0) return false;
+        uint64_t period = F_CPU / 1000 * 108;
+        uint64_t t = native::_cycles - native::_ir_press_cycles;
+        uint64_t frame = t / period;
+        if (!native::_ir_held && native::_ir_press_cycles + frame * period >= native::_ir_release_cycles) return false;
+        return native::ir_frame_mark(t - frame * period, frame == 0);
+    }
+
+    void CharLcd::begin(uint8_t cols, uint8_t rows) {
+        _cols = min(cols, MAX_COLS);
+        _rows = min(rows, MAX_ROWS);
+        clear();
+    }
+
+    void CharLcd::clear() {
+        for (uint8_t r = 0; r < MAX_ROWS; ++r) {
+            memset(_lines[r], ' ', _cols);
+            _lines[r][_cols] = '\0';
+        }
+        _col = 0;
+        _row = 0;
+        if (native::lcd_changed) native::lcd_changed(true);
+    }
+
+    void CharLcd::setCursor(uint8_t col, uint8_t row) {
+        _col = col;
+        _row = row < _rows ? row : _rows - 1;
+    }
+
+    size_t CharLcd::write(uint8_t c) {
+        if (_col >= _cols) return 0;
+        _lines[_row][_col++] = c;
+        if (native::lcd_changed) native::lcd_changed(false);
+        return 1;
+    }
+}
+
+unsigned long millis() { return hal::native::_cycles / (F_CPU / 1000); }
+
+unsigned long micros() { return hal::native::_cycles / (F_CPU / 1000000); }
+
+void delay(unsigned long ms) { hal::native::advance_micros(ms * 1000); }
+
+void delayMicroseconds(unsigned int us) { hal::native::advance_micros(us); }
+
+void cli() { hal::native::_interrupts = false; }
+
+void sei() {
+    hal::native::_interrupts = true;
+    if (hal::native::_pending && !hal::native::_in_interrupt) hal::native::run_interrupt();
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) { hal::native::_pins[pin % sizeof(hal::native::_pins)] = value; }
+
+int digitalRead(uint8_t pin) { return hal::native::_pins[pin % sizeof(hal::native::_pins)]; }
+
+void analogWrite(uint8_t pin, int value) { hal::native::_pins[pin % sizeof(hal::native::_pins)] = value; }
+
+long random(long upper) { return upper > 0 ? rand() % upper : 0; }
+
+long random(long lower, long upper) { return lower < upper ? lower + random(upper - lower) : lower; }
+
+void randomSeed(unsigned long seed) { srand(seed); }
+
+char* itoa(int value, char* buffer, int base) {
+    if (base == 10) sprintf(buffer, "%d", value);
+    else if (base == 16) sprintf(buffer, "%x", value);
+    else if (base == 8) sprintf(buffer, "%o", value);
+    else {
+        char digits[33];
+        unsigned int v = value;
+        int i = 0;
+        do { digits[i++] = '0' + v % base; v /= base; } while (v);
+        for (int j = 0; j < i; ++j) buffer[j] = digits[i - 1 - j];
+        buffer[i] = '\0';
+    }
+    return buffer;
+}
+
+char* dtostrf(double value, signed char width, unsigned char precision, char* buffer) {
+    sprintf(buffer, "%*.*f", width, precision, value);
+    return buffer;
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+size_t Print::print(long value, int base) {
+    if (base == DEC && value < 0) return print('-') + print((unsigned long)-value, base);
+    return print((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    char buffer[8 * sizeof(long) + 1];
+    char* str = &buffer[sizeof(buffer) - 1];
+    *str = '\0';
+    if (base < 2) base = 10;
+    do {
+        char c = value % base;
+        value /= base;
+        *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (value);
+    return write(str);
+}
+
+size_t Print::print(double value, int digits) {
+
+    if (isnan(value)) return write("nan");
+    if (isinf(value)) return write("inf");
+    if (value > 4294967040.0 || value < -4294967040.0) return write("ovf");
+
+    size_t n = 0;
+    if (value < 0.0) {
+        n += print('-');
+        value = -value;
+    }
+
+    // round as Arduino does, i.e. 1.005 with 2 digits is 1.01
+    double rounding = 0.5;
+    for (int i = 0; i < digits; ++i) rounding /= 10.0;
+    value += rounding;
+
+    unsigned long integer = (unsigned long)value;
+    double remainder = value - (double)integer;
+    n += print(integer);
+
+    if (digits > 0) n += print('.');
+    while (digits-- > 0) {
+        remainder *= 10.0;
+        unsigned int digit = (unsigned int)remainder;
+        n += print(digit);
+        remainder -= digit;
+    }
+
+    return n;
+}
+
+size_t HardwareSerial::write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+
+HardwareSerial Serial;
+
+#endif
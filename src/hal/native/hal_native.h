@@ -0,0 +1,173 @@
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+#include <stdio.h>
+
+#include "arduino.h"
+#include "rtc.h"
+
+// Emulation of the board on a workstation. Time is virtual, it runs only when the firmware
+// calls delay() or a host tool calls hal::native::advance_micros(), which also runs the step
+// timer interrupt at its exact ticks of the emulated 16 MHz CPU (the interrupt itself takes no
+// time). SD card files are read from a directory (see hal::native::set_storage_root), EEPROM
+// starts erased, the IR receiver pin gets pulses of an emulated remote (hal::native::ir_press)
+// and the LCD is a buffer.
+
+// interrupt service routine of the step timer, the sketch defines it as on the Mega
+#define HAL_TIMER_ISR void hal_timer_isr()
+
+// hal::cycle_counter wraps every 16384 CPU cycles (1 ms), mask differences of its values by this
+#define HAL_CYCLE_MASK  0x3FFF
+
+namespace hal {
+
+    namespace native {
+
+        extern volatile uint8_t motors_port;
+        extern volatile uint8_t motors_ddr;
+
+        // called with the new value after every change of the motors port (e.g. to record step
+        // traces with timestamps of cycles()), nothing by default
+        extern void (*motors_changed)(uint8_t port);
+
+        // called after every write to the LCD, 'cleared' is true for clear() (e.g. to measure the
+        // latency of the user interface), nothing by default
+        extern void (*lcd_changed)(bool cleared);
+
+        inline void set_motors_port(uint8_t value) {
+            uint8_t old = motors_port;
+            motors_port = value;
+            if (value != old && motors_changed) motors_changed(value);
+        }
+
+        // advances virtual time and runs all the step timer interrupts which happen meanwhile
+        void advance_micros(uint32_t us);
+
+        // virtual time in CPU cycles
+        uint64_t cycles();
+
+        // directory which is the root of the emulated SD card ("SD" by default)
+        void set_storage_root(const char* path);
+
+        // starts holding a key of the emulated NEC remote, its frame takes 67.5 ms and then
+        // repeat frames start every 108 ms until the key is released (the last one is finished)
+        void ir_press(uint32_t code);
+        void ir_release();
+
+        // content of the EEPROM (EEPROM_SIZE bytes)
+        uint8_t* eeprom();
+
+        const uint16_t EEPROM_SIZE = 4096;
+    }
+
+    inline uint8_t motors_read() { return native::motors_port; }
+
+    inline void motors_write(uint8_t value) { native::set_motors_port(value); }
+
+    inline void motors_toggle(uint8_t mask) { native::set_motors_port(native::motors_port ^ mask); }
+
+    inline void motors_clear(uint8_t mask) { native::set_motors_port(native::motors_port & ~mask); }
+
+    inline void motors_output(uint8_t mask) {
+        native::motors_ddr |= mask;
+        native::set_motors_port(native::motors_port & ~mask);
+    }
+
+    // starts the step timer, HAL_TIMER_ISR is then called every 'top' CPU cycles
+    void timer_start(uint16_t top);
+
+    inline void timer_restart() {}
+
+    // interrupts are run right at their ticks of the virtual time, so there is no latency
+    inline uint16_t timer_count() { return 0; }
+
+    // the interrupt takes no virtual time, so durations measured inside of it are zero, it wraps
+    // as on the Mega
+    inline uint16_t cycle_counter() { return native::cycles() & HAL_CYCLE_MASK; }
+
+    // the host has no such limits, the RAM of the Mega is not measured
+    inline uint16_t ram_free() { return 0; }
+    inline uint16_t ram_free_min() { return 0; }
+
+    inline uint8_t eeprom_read(uint16_t address) { return native::eeprom()[address % native::EEPROM_SIZE]; }
+
+    inline void eeprom_update(uint16_t address, uint8_t value) { native::eeprom()[address % native::EEPROM_SIZE] = value; }
+
+    // file of the emulated SD card opened for reading, copies share the same handle as on Arduino
+    class File {
+
+        public:
+
+            File(FILE* file = nullptr, const char* name = "") : _file(file) {
+                strncpy(_name, name, sizeof(_name) - 1);
+                _name[sizeof(_name) - 1] = '\0';
+            }
+
+            operator bool() const { return _file != nullptr; }
+
+            // returns the next byte or -1 at the end of the file
+            int read() { return _file ? fgetc(_file) : -1; }
+            int available() { return _file && size() > position() ? size() - position() : 0; }
+
+            uint32_t position() { return _file ? ftell(_file) : 0; }
+            bool seek(uint32_t position) { return _file && fseek(_file, position, SEEK_SET) == 0; }
+            uint32_t size();
+
+            const char* name() const { return _name; }
+
+            // directories are not listed
+            File openNextFile() { return File(); }
+
+            void close() {
+                if (_file) fclose(_file);
+                _file = nullptr;
+            }
+
+        private:
+
+            FILE* _file;
+            char _name[13];
+    };
+
+    bool storage_begin();
+
+    File storage_open(const char* path);
+
+    inline void ir_begin() {}
+
+    // returns true during a pulse of the emulated remote
+    bool ir_mark();
+
+    // HD44780 compatible display, the content is kept in a buffer of text lines
+    class CharLcd : public Print {
+
+        public:
+
+            static const uint8_t MAX_ROWS = 4;
+            static const uint8_t MAX_COLS = 40;
+
+            CharLcd(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t) {}
+
+            void begin(uint8_t cols, uint8_t rows);
+            void createChar(uint8_t, uint8_t[]) {}
+            void noCursor() {}
+            void clear();
+            void setCursor(uint8_t col, uint8_t row);
+
+            using Print::write;
+            size_t write(uint8_t c) override;
+
+            // returns a line of the display, custom characters are their codes 0..7
+            const char* line(uint8_t row) const { return _lines[row % MAX_ROWS]; }
+
+        private:
+
+            uint8_t _cols = 16;
+            uint8_t _rows = 2;
+            uint8_t _col = 0;
+            uint8_t _row = 0;
+            char _lines[MAX_ROWS][MAX_COLS + 1];
+    };
+}
+
+#endif
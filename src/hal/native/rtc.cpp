@@ -0,0 +1,64 @@
+#ifndef ARDUINO
+
+#include "hal_native.h"
+
+static const uint8_t days_in_month[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+DateTime::DateTime(uint32_t unix_time) {
+
+    uint32_t t = unix_time - SECONDS_FROM_1970_TO_2000;
+
+    _ss = t % 60; t /= 60;
+    _mm = t % 60; t /= 60;
+    _hh = t % 24;
+    uint16_t days = t / 24;
+
+    uint8_t leap;
+    for (_y = 0; ; ++_y) {
+        leap = _y % 4 == 0;
+        if (days < 365u + leap) break;
+        days -= 365 + leap;
+    }
+    for (_m = 1; ; ++_m) {
+        uint8_t month_days = days_in_month[_m - 1] + (leap && _m == 2);
+        if (days < month_days) break;
+        days -= month_days;
+    }
+    _d = days + 1;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec)
+    : _y(year >= 2000 ? year - 2000 : year), _m(month), _d(day), _hh(hour), _mm(min), _ss(sec) {}
+
+uint16_t DateTime::days_since_2000() const {
+    uint16_t days = _d;
+    for (uint8_t i = 1; i < _m; ++i) days += days_in_month[i - 1];
+    if (_m > 2 && _y % 4 == 0) ++days;
+    return days + 365 * _y + (_y + 3) / 4 - 1;
+}
+
+uint32_t RTC_Millis::lastUnix = SECONDS_FROM_1970_TO_2000;
+uint32_t RTC_Millis::lastMillis = 0;
+
+void RTC_Millis::adjust(const DateTime& dt) {
+    lastMillis = millis();
+    lastUnix = dt.unixtime();
+}
+
+DateTime RTC_Millis::now() {
+    uint32_t elapsed_seconds = (millis() - lastMillis) / 1000;
+    lastMillis += elapsed_seconds * 1000;
+    lastUnix += elapsed_seconds;
+    return DateTime(lastUnix);
+}
+
+void RTC_DS3231::adjust(const DateTime& dt) {
+    _millis = millis();
+    _unix = dt.unixtime();
+}
+
+DateTime RTC_DS3231::now() {
+    return DateTime(_unix + (millis() - _millis) / 1000);
+}
+
+#endif
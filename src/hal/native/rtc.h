@@ -0,0 +1,96 @@
+#ifndef HAL_NATIVE_RTC_H
+#define HAL_NATIVE_RTC_H
+
+#include <stdint.h>
+
+// Subset of RTClib used by the firmware, dates are valid from 2000 to 2099
+
+#define SECONDS_FROM_1970_TO_2000 946684800
+
+class TimeSpan {
+
+    public:
+
+        TimeSpan(int32_t seconds = 0) : _seconds(seconds) {}
+        TimeSpan(int16_t days, int8_t hours, int8_t minutes, int8_t seconds)
+            : _seconds(days * 86400L + hours * 3600L + minutes * 60L + seconds) {}
+
+        int16_t days() const { return _seconds / 86400L; }
+        int8_t hours() const { return _seconds / 3600 % 24; }
+        int8_t minutes() const { return _seconds / 60 % 60; }
+        int8_t seconds() const { return _seconds % 60; }
+        int32_t totalseconds() const { return _seconds; }
+
+        TimeSpan operator+(const TimeSpan& right) const { return TimeSpan(_seconds + right._seconds); }
+        TimeSpan operator-(const TimeSpan& right) const { return TimeSpan(_seconds - right._seconds); }
+
+    private:
+
+        int32_t _seconds;
+};
+
+class DateTime {
+
+    public:
+
+        DateTime(uint32_t unix_time = SECONDS_FROM_1970_TO_2000);
+        DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0);
+
+        uint16_t year() const { return 2000 + _y; }
+        uint8_t month() const { return _m; }
+        uint8_t day() const { return _d; }
+        uint8_t hour() const { return _hh; }
+        uint8_t minute() const { return _mm; }
+        uint8_t second() const { return _ss; }
+
+        // 0 is Sunday
+        uint8_t dayOfTheWeek() const { return (days_since_2000() + 6) % 7; }
+
+        // seconds since 2000-01-01 and 1970-01-01
+        uint32_t secondstime() const { return days_since_2000() * 86400UL + _hh * 3600UL + _mm * 60UL + _ss; }
+        uint32_t unixtime() const { return secondstime() + SECONDS_FROM_1970_TO_2000; }
+
+        DateTime operator+(const TimeSpan& span) const { return DateTime(unixtime() + span.totalseconds()); }
+        DateTime operator-(const TimeSpan& span) const { return DateTime(unixtime() - span.totalseconds()); }
+        TimeSpan operator-(const DateTime& right) const { return TimeSpan(unixtime() - right.unixtime()); }
+
+        bool operator<(const DateTime& right) const { return unixtime() < right.unixtime(); }
+        bool operator==(const DateTime& right) const { return unixtime() == right.unixtime(); }
+
+    private:
+
+        uint16_t days_since_2000() const;
+
+        uint8_t _y, _m, _d, _hh, _mm, _ss;
+};
+
+// software clock counting from the last adjustment by millis()
+class RTC_Millis {
+
+    public:
+
+        static void adjust(const DateTime& dt);
+        static DateTime now();
+
+    protected:
+
+        static uint32_t lastUnix;
+        static uint32_t lastMillis;
+};
+
+// the DS3231 module of the emulated board keeps the time it was adjusted to, it starts at 2000-01-01
+class RTC_DS3231 {
+
+    public:
+
+        bool begin() { return true; }
+        void adjust(const DateTime& dt);
+        DateTime now();
+
+    private:
+
+        uint32_t _unix = SECONDS_FROM_1970_TO_2000;
+        uint32_t _millis = 0;
+};
+
+#endif
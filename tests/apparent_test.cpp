@@ -0,0 +1,56 @@
+#define FROM_LIB
+
+#include "test.h"
+#include "core/mount_controller.h"
+#include "core/rtc_ds3231.h"
+
+static RtcDS3231 rtc;
+static MountController mount(MotorController::instance());
+
+// J2000 (ICRS) positions of bright stars without proper motion and their apparent places
+// (geocentric, RA from the mean equinox of the date as LST is the mean one) computed by
+// ERFA, the IAU SOFA library (atci13 minus the equation of the origins and ee06a)
+struct reference_t {
+    const char* star;
+    float j2000_dec, j2000_ra;
+    double apparent_dec, apparent_ra;
+};
+
+static const reference_t references_2026[] = {
+    { "Polaris",    89.264110f,  37.954540f,  89.375194, 47.152450 },
+    { "Sirius",    -16.716117f, 101.287155f, -16.740290, 101.587750 },
+    { "Vega",       38.783689f, 279.234735f,  38.810635, 279.456509 },
+    { "Canopus",   -52.695661f,  95.987958f, -52.704149, 96.138392 },
+    { "Betelgeuse",  7.407064f,  88.792939f,   7.413376, 89.158410 },
+    { "Alpheratz",  29.090431f,   2.096916f,  29.243402, 2.447834 },
+};
+
+static const reference_t references_2035[] = {
+    { "Polaris",    89.264110f,  37.954540f,  89.408495, 50.106989 },
+    { "Sirius",    -16.716117f, 101.287155f, -16.760657, 101.683366 },
+    { "Vega",       38.783689f, 279.234735f,  38.813360, 279.527042 },
+    { "Canopus",   -52.695661f,  95.987958f, -52.723762, 96.187991 },
+    { "Betelgeuse",  7.407064f,  88.792939f,   7.406509, 89.270821 },
+    { "Alpheratz",  29.090431f,   2.096916f,  29.284706, 2.547639 },
+};
+
+static void check_references(const reference_t* references, int count) {
+    for (int i = 0; i < count; ++i) {
+        const reference_t& r = references[i];
+        MountController::coord_t apparent = mount.J2000_to_apparent({ r.j2000_dec, r.j2000_ra });
+        double error = test::distance_arcsec(apparent.dec, apparent.ra, r.apparent_dec, r.apparent_ra);
+        printf("    %-10s %6.2f\"\n", r.star, error);
+        CHECK(error < 1.0);
+    }
+}
+
+TEST(apparent_reference_stars) {
+
+    mount.initialize();
+
+    rtc.sync(DateTime(2026, 10, 18, 20, 0, 0));
+    check_references(references_2026, sizeof(references_2026) / sizeof(references_2026[0]));
+
+    rtc.sync(DateTime(2035, 3, 1, 2, 30, 0));
+    check_references(references_2035, sizeof(references_2035) / sizeof(references_2035[0]));
+}
@@ -0,0 +1,41 @@
+#include "test.h"
+#include "core/axis.h"
+
+// conversions of Axis<Config> must agree with each other, pulses_to_bam is the derivative of
+// the axis angle by pulses, so it is compared with differences of pulses_to_revs as well
+template <class A>
+static void check_axis() {
+
+    const double deg_per_rev = 1.0 / A::REVS_PER_DEG;
+
+    double max_bam = 0, max_rate = 0, max_round_trip = 0;
+    typedef typename A::pulses_t pulses_t;
+    for (long pulses = -(long)A::PULSES_PER_TURN; pulses <= (long)A::PULSES_PER_TURN; pulses += (long)(A::PULSES_PER_TURN / 997) + 1) {
+
+        // the binary angle of the balance (deg) against revolutions of the balance
+        double deg = (double)A::pulses_to_bam(pulses_t(pulses)) * (360.0 / 4294967296.0);
+        double expected = A::pulses_to_revs(pulses_t(pulses)) * deg_per_rev;
+        max_bam = fmax(max_bam, fabs(deg - expected) * 3600);
+
+        // a single pulse as the finite difference of the binary angle
+        double step = (double)(A::pulses_to_bam(pulses_t(pulses + 1000)) - A::pulses_to_bam(pulses_t(pulses - 1000))) / 2000;
+        max_rate = fmax(max_rate, fabs(step / (4294967296.0 / A::PULSES_PER_TURN) - 1));
+
+        // revolutions to binary angles and back
+        typename A::revs_t revs = A::pulses_to_revs(pulses_t(pulses));
+        max_round_trip = fmax(max_round_trip, fabs(A::bam_to_revs(A::revs_to_bam(revs)) - revs) * deg_per_rev * 3600);
+    }
+
+    printf("    max. difference of BAM and revolutions %.3g\", pulse rate %.2g, round trip %.3g\"\n", max_bam, max_rate, max_round_trip);
+    CHECK(max_bam < 0.5);
+    CHECK(max_rate < 1e-6);
+    CHECK(max_round_trip < 0.5);
+
+    // a full turn of the mount
+    CHECK_NEAR(A::deg_to_revs(360) * A::MICROSTEPS_PER_REV * 2, A::PULSES_PER_TURN, A::PULSES_PER_TURN * 1e-6);
+    CHECK_NEAR((double)A::pulses_to_bam(pulses_t((long)A::PULSES_PER_TURN)), 4294967296.0, 4294967296.0 / A::PULSES_PER_TURN);
+}
+
+TEST(axis_dec) { check_axis<DecAxis>(); }
+
+TEST(axis_ra) { check_axis<RaAxis>(); }
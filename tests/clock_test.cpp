@@ -0,0 +1,47 @@
+#include "test.h"
+#include "core/clock.h"
+
+// Clock with the direct LST formula exposed, the time runs by a virtual source stepped by the test
+class TestClock : public Clock {
+
+    public:
+
+        void obtain_time() override {}
+
+        void sync(const DateTime& dt) override {
+            set_time(dt);
+            set_LST(compute_LST());
+        }
+
+        static double direct_LST() { return compute_LST(); }
+};
+
+TEST(clock_lst_year) {
+
+    VirtualTime time;
+    time.set_rate(0);
+    Clock::set_time_source(time);
+
+    TestClock clock;
+    clock.sync(DateTime(2026, 1, 1, 0, 0, 0));
+
+    // the incremental LST is compared with the direct formula every day for a year, the time is
+    // stepped by an hour (Clock::update must run at least once an hour) plus a few ms, so the
+    // comparisons do not fall on whole seconds only
+    double first = 0, max_error = 0, error = 0;
+    for (int hour = 1; hour <= 365 * 24; ++hour) {
+        time.step(3600000000UL + 1234);
+        Clock::update();
+        if (hour % 24) continue;
+        error = remainder(Clock::get_decimal_LST() - TestClock::direct_LST(), 24) * 3600;
+        if (hour == 24) first = error;
+        max_error = fmax(max_error, fabs(error));
+    }
+
+    printf("    LST - direct formula (s): max. %.4f, drift over the year %.4f\n", max_error, error - first);
+    CHECK(max_error < 0.05);
+    CHECK(fabs(error - first) < 0.02);
+
+    static BoardTime board;
+    Clock::set_time_source(board);
+}
@@ -0,0 +1,24 @@
+// Quantities of an axis passed to the conversions of the other axis must not compile (see
+// axis_value_t of core/axis.h). The build of each AXIS_MISMATCH_xxx case is a test which is
+// expected to fail, the case without any of them is the same code with correct axes.
+#include "core/axis.h"
+
+void axis_mismatch() {
+
+    DecAxis::pulses_t dec_pulses(1000);
+    DecAxis::revs_t dec_revs(0.5f);
+
+    #if defined(AXIS_MISMATCH_PULSES)
+        RaAxis::pulses_to_bam(dec_pulses);
+    #elif defined(AXIS_MISMATCH_REVS)
+        RaAxis::revs_to_pulses(dec_revs);
+    #elif defined(AXIS_MISMATCH_ASSIGN)
+        RaAxis::pulses_t ra_pulses = dec_pulses;
+    #elif defined(AXIS_MISMATCH_NUMBER)
+        RaAxis::revs_to_bam(0.5f);
+    #else
+        DecAxis::pulses_to_bam(dec_pulses);
+        DecAxis::revs_to_pulses(dec_revs);
+        RaAxis::revs_to_bam(RaAxis::revs_t(0.5f));
+    #endif
+}
@@ -0,0 +1,131 @@
+#define FROM_LIB
+
+#include <vector>
+
+#include "test.h"
+#include "control/control.h"
+#include "core/canon_eos1000d.h"
+#include "core/rtc_ds3231.h"
+
+#define LOOP_MS     10      // the same as loop() of the sketch
+
+static RtcDS3231 rtc;
+static CanonEOS1000D camera;
+static MountController mount(MotorController::instance());
+
+static unsigned long max_update_ms = 0;
+static std::vector<unsigned long> clears;
+
+static void on_lcd(bool cleared) {
+    if (cleared) clears.push_back(millis());
+}
+
+// runs the main loop for 'ms' and measures the longest Control::update
+static void run(Control& control, unsigned long ms) {
+    unsigned long start = millis();
+    while (millis() - start < ms) {
+        unsigned long begin = millis();
+        control.update();
+        max_update_ms = max(max_update_ms, millis() - begin);
+        delay(LOOP_MS);
+    }
+}
+
+static void tap(Control& control, uint32_t key) {
+    hal::native::ir_press(key);
+    run(control, 300);
+    hal::native::ir_release();
+    run(control, 2 * IR_RELEASE_MS);
+}
+
+TEST(control_refused_goto) {
+
+    rtc.sync(DateTime(2026, 10, 18, 20, 0, 0));
+    Control control(mount, camera, rtc);
+    control.initialize();
+
+    // every direction is forbidden, so any GOTO is refused
+    for (uint8_t row = 0; row < KEEP_OUT_ROWS; ++row)
+        for (uint8_t col = 0; col < KEEP_OUT_COLS; ++col) mount.get_keep_out().set_cell_blocked(row, col, true);
+
+    // the GOTO menu, ENTER through the fields of the position and once more to start the slew
+    tap(control, C_GOTO);
+    for (int i = 0; i < 5; ++i) tap(control, C_ENTER);
+
+    max_update_ms = 0;
+    clears.clear();
+    hal::native::lcd_changed = on_lcd;
+    hal::native::ir_press(C_ENTER);
+    run(control, 300);
+    hal::native::ir_release();
+    run(control, 3000);
+    hal::native::lcd_changed = nullptr;
+    unsigned long refused = clears.empty() ? 0 : clears[0];
+
+    // the warning is displayed and the main menu is back after INFO_SCREEN_MS, while loop() runs
+    printf("    longest update %lu ms, %u redraws, the warning displayed for %ld ms\n", max_update_ms,
+           (unsigned)clears.size(), clears.size() == 2 ? (long)(clears[1] - refused) : -1L);
+    CHECK(max_update_ms <= LOOP_MS);
+    CHECK(clears.size() == 2);
+    if (clears.size() == 2) CHECK_NEAR(clears[1] - refused, INFO_SCREEN_MS, 2 * LOOP_MS);
+    CHECK(!mount.is_moving());
+
+    mount.get_keep_out().clear();
+}
+
+TEST(control_push_latency) {
+
+    rtc.sync(DateTime(2026, 10, 18, 20, 0, 0));
+    Control control(mount, camera, rtc);
+    control.initialize();
+    run(control, 1000);
+
+    // GOTO is not a hold key, its menu comes with its frame (67.5 ms), not after the release
+    clears.clear();
+    hal::native::lcd_changed = on_lcd;
+    unsigned long press = millis();
+    hal::native::ir_press(C_GOTO);
+    run(control, 300);
+    hal::native::ir_release();
+    run(control, 2 * IR_RELEASE_MS);
+    hal::native::lcd_changed = nullptr;
+
+    long latency = clears.empty() ? -1 : (long)(clears[0] - press);
+    printf("    GOTO menu %ld ms after the press\n", latency);
+    CHECK(!clears.empty());
+    CHECK(latency < 100);
+}
+
+TEST(control_slew_learning) {
+
+    // the slew model starts without any correction (erased EEPROM)
+    for (uint16_t i = 0; i < sizeof(MotorController::slew_model_t); ++i) hal::eeprom_update(EEPROM_ADDR + 18 + i, 0xFF);
+
+    rtc.sync(DateTime(2026, 10, 18, 20, 0, 0));
+    Control control(mount, camera, rtc);
+    control.initialize();
+    run(control, 1000);
+
+    // the same slew back and forth, Control::update learns each of them and saves the model
+    const int slews = 12;
+    MotorController& motors = MotorController::instance();
+    float errors[slews];
+    for (int i = 0; i < slews; ++i) {
+        float revs = i % 2 ? -40 : 40;
+        float predicted_ms = motors.estimate_fast_turn_time(revs / 4, revs);
+        unsigned long start = millis();
+        motors.fast_turn(revs / 4, revs, false);
+        while (mount.is_moving()) hal::native::advance_micros(100);
+        errors[i] = fabs((millis() - start) - predicted_ms);
+        run(control, 100);
+    }
+    printf("    error of the predicted slew duration %.0f ms at first, %.0f ms after %d slews\n",
+           errors[0], errors[slews - 1], slews);
+    CHECK(errors[slews - 1] < errors[0] / 4);
+
+    // the model is loaded back from EEPROM by the next start
+    MotorController::slew_model_t learned = motors.get_slew_model();
+    mount.set_slew_model(MotorController::slew_model_t {});
+    control.initialize();
+    CHECK(memcmp(&learned, &motors.get_slew_model(), sizeof(learned)) == 0);
+}
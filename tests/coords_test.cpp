@@ -0,0 +1,93 @@
+#include "test.h"
+#include "core/coords.h"
+
+// Pointing error of the coordinate math of each scalar type MOUNT_REAL can be. Points of the
+// sky are rotated by a general (misaligned pole) rotation to local coordinates and back, the
+// same conversions as MountController does, and compared with the rotation in long double.
+
+typedef long double ld;
+
+// the reference, only rotation matrices are made of it
+template <> struct scalar_math<ld> {
+    static void sin_cos(float deg, ld& sine, ld& cosine) {
+        sine = sinl(deg * (ld)M_PI / 180);
+        cosine = cosl(deg * (ld)M_PI / 180);
+    }
+};
+
+static const float POLE_DEC = 52.3f, POLE_RA = 171.7f, POLE_ROLL = 12.9f;
+
+// rotation about Y by 90 - dec, then about Z by ra and about X by roll
+template <class T>
+static matrix<T> pole_rotation(float dec, float ra, float roll) {
+
+    T sd, cd, sr, cr, sx, cx;
+    scalar_math<T>::sin_cos(dec, sd, cd);
+    scalar_math<T>::sin_cos(ra, sr, cr);
+    scalar_math<T>::sin_cos(roll, sx, cx);
+    T zero = 0.0f, one = 1.0f;
+
+    matrix<T> m_dec = {{{ sd, zero, -cd }, { zero, one, zero }, { cd, zero, sd }}};
+    matrix<T> m_ra = {{{ cr, sr, zero }, { -sr, cr, zero }, { zero, zero, one }}};
+    matrix<T> m_roll = {{{ one, zero, zero }, { zero, cx, sx }, { zero, -sx, cx }}};
+    return m_roll * m_dec * m_ra;
+}
+
+template <class T>
+static matrix<T> transposed(const matrix<T>& m) {
+    matrix<T> t;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j) t.data[i][j] = m.data[j][i];
+    return t;
+}
+
+static ld distance_arcsec(polar_t a, ld dec, ld ra) {
+    const ld rad = M_PI / 180;
+    ld c = sinl(a.dec * rad) * sinl(dec * rad) + cosl(a.dec * rad) * cosl(dec * rad) * cosl((a.ra - ra) * rad);
+    ld s = hypotl(cosl(dec * rad) * sinl((a.ra - ra) * rad),
+                  cosl(a.dec * rad) * sinl(dec * rad) - sinl(a.dec * rad) * cosl(dec * rad) * cosl((a.ra - ra) * rad));
+    return atan2l(s, c) / rad * 3600;
+}
+
+template <class T>
+static void check_precision(const char* name, ld max_limit, ld mean_limit) {
+
+    const ld rad = M_PI / 180;
+    matrix<T> to_local = pole_rotation<T>(POLE_DEC, POLE_RA, POLE_ROLL);
+    matrix<T> to_global = transposed(to_local);
+    matrix<ld> reference = pole_rotation<ld>(POLE_DEC, POLE_RA, POLE_ROLL);
+
+    ld max_error = 0, total_error = 0, max_round_trip = 0;
+    int count = 0;
+    for (float dec = -89.5f; dec < 90; dec += 1.9f) {
+        for (float ra = 0.37f; ra < 360; ra += 3.3f) {
+
+            polar_t local = cartesian_to_polar(to_local * polar_to_cartesian<T>({ dec, ra }));
+            polar_t global = cartesian_to_polar(to_global * polar_to_cartesian<T>(local));
+
+            cartesian<ld> p = reference * cartesian<ld>{ cosl(dec * rad) * cosl(ra * rad), cosl(dec * rad) * sinl(ra * rad), sinl(dec * rad) };
+            ld error = distance_arcsec(local, asinl(p.z) / rad, atan2l(p.y, p.x) / rad);
+            max_error = fmaxl(max_error, error);
+            total_error += error;
+            max_round_trip = fmaxl(max_round_trip, distance_arcsec(global, dec, ra));
+            ++count;
+        }
+    }
+
+    printf("    %s: max. error %.3Lf\", mean %.3Lf\", round trip %.3Lf\"\n", name, max_error, total_error / count, max_round_trip);
+    CHECK(max_error < max_limit);
+    CHECK(total_error / count < mean_limit);
+    CHECK(max_round_trip < 2 * max_limit);
+}
+
+TEST(coords_float) {
+    check_precision<float>("float", 0.2, 0.05);
+}
+
+TEST(coords_double) {
+    check_precision<double>("double", 0.1, 0.03);
+}
+
+TEST(coords_fixed) {
+    check_precision<fixed_t>("fixed_t", 0.2, 0.05);
+}
@@ -0,0 +1,29 @@
+#include "test.h"
+#include "hal/hal.h"
+
+TEST(hal_virtual_time) {
+
+    unsigned long ms = millis();
+    unsigned long us = micros();
+    uint64_t cycles = hal::native::cycles();
+
+    hal::native::advance_micros(2500);
+
+    CHECK(millis() - ms >= 2 && millis() - ms <= 3);
+    CHECK(micros() - us == 2500);
+    CHECK(hal::native::cycles() - cycles == 2500ULL * (F_CPU / 1000000));
+
+    // delay() runs virtual time as well
+    us = micros();
+    delay(10);
+    CHECK(micros() - us == 10000);
+}
+
+TEST(hal_eeprom) {
+
+    // starts erased, updated bytes are read back
+    CHECK(hal::eeprom_read(100) == 0xFF);
+    hal::eeprom_update(100, 0x5A);
+    CHECK(hal::eeprom_read(100) == 0x5A);
+    hal::eeprom_update(100, 0xFF);
+}
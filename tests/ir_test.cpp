@@ -0,0 +1,97 @@
+#define FROM_LIB
+
+#include <vector>
+
+#include "test.h"
+#include "core/motor_controller.h"
+#include "core/ir_receiver.h"
+
+#define FRAME_US    67500   // NEC frame of a key (leader, 32 bits and the stop pulse)
+#define REPEAT_US   11813   // NEC repeat frame (leader, short space and the stop pulse)
+#define PERIOD_US   108000  // frames and repeats start every 108 ms
+
+// runs the step timer (and so the decoder) for 'us' and collects the events
+static void run(unsigned long us, std::vector<IrReceiver::event_t>& events) {
+    for (unsigned long t = 0; t < us; t += 100) {
+        hal::native::advance_micros(100);
+        IrReceiver::event_t event;
+        while (IrReceiver::pop(event)) events.push_back(event);
+    }
+}
+
+static void start() {
+    MotorController::instance().initialize();
+    IrReceiver::initialize();
+    std::vector<IrReceiver::event_t> stale;
+    run(2 * IR_RELEASE_MS * 1000UL, stale);
+}
+
+TEST(ir_tap) {
+
+    // a key released before any repeat frame is pressed at the end of its frame and released
+    // IR_RELEASE_MS later with the time of the same frame
+    start();
+    std::vector<IrReceiver::event_t> events;
+    unsigned long press = millis();
+    hal::native::ir_press(0x00FF629D);
+    run(50000, events);
+    hal::native::ir_release();
+    run(FRAME_US + 2 * IR_RELEASE_MS * 1000UL, events);
+
+    CHECK(events.size() == 2);
+    if (events.size() != 2) return;
+    CHECK(events[0].type == IrReceiver::IR_KEY_PRESS && events[0].key == 0x00FF629D);
+    CHECK_NEAR(events[0].ms - press, FRAME_US / 1000, 1);
+    CHECK(events[1].type == IrReceiver::IR_KEY_RELEASE && events[1].key == 0x00FF629D);
+    CHECK(events[1].ms == events[0].ms);
+}
+
+TEST(ir_hold) {
+
+    // repeat frames keep the key pressed, the first one after LONG_HOLD_TIME_MS is a hold and
+    // the release has the time of the last one
+    start();
+    std::vector<IrReceiver::event_t> events;
+    unsigned long press = millis();
+    hal::native::ir_press(0x00FF18E7);
+    run(1500000, events);
+    hal::native::ir_release();
+    run(PERIOD_US + 2 * IR_RELEASE_MS * 1000UL, events);
+
+    // repeats end 108 ms apart, the last one starts before the release (at 1.5 s)
+    unsigned long hold_us = PERIOD_US + REPEAT_US;
+    while (hold_us < FRAME_US + LONG_HOLD_TIME_MS * 1000UL) hold_us += PERIOD_US;
+    unsigned long last_us = 1500000 / PERIOD_US * PERIOD_US + REPEAT_US;
+
+    printf("    press %lu ms, hold %lu ms, release %lu ms\n", events.size() > 0 ? events[0].ms - press : 0,
+           events.size() > 1 ? events[1].ms - press : 0, events.size() > 2 ? events[2].ms - press : 0);
+    CHECK(events.size() == 3);
+    if (events.size() != 3) return;
+    CHECK(events[0].type == IrReceiver::IR_KEY_PRESS && events[0].key == 0x00FF18E7);
+    CHECK(events[1].type == IrReceiver::IR_KEY_HOLD && events[1].key == 0x00FF18E7);
+    CHECK(events[2].type == IrReceiver::IR_KEY_RELEASE && events[2].key == 0x00FF18E7);
+    CHECK_NEAR(events[0].ms - press, FRAME_US / 1000, 1);
+    CHECK_NEAR(events[1].ms - press, hold_us / 1000, 1);
+    CHECK_NEAR(events[2].ms - press, last_us / 1000, 1);
+}
+
+TEST(ir_next_key) {
+
+    // a frame of another key releases the previous one at once
+    start();
+    std::vector<IrReceiver::event_t> events;
+    hal::native::ir_press(0x00FF629D);
+    run(300000, events);
+    hal::native::ir_press(0x00FFA857);
+    run(300000, events);
+    hal::native::ir_release();
+    run(PERIOD_US + 2 * IR_RELEASE_MS * 1000UL, events);
+
+    CHECK(events.size() == 4);
+    if (events.size() != 4) return;
+    CHECK(events[0].type == IrReceiver::IR_KEY_PRESS && events[0].key == 0x00FF629D);
+    CHECK(events[1].type == IrReceiver::IR_KEY_RELEASE && events[1].key == 0x00FF629D);
+    CHECK(events[2].type == IrReceiver::IR_KEY_PRESS && events[2].key == 0x00FFA857);
+    CHECK(events[3].type == IrReceiver::IR_KEY_RELEASE && events[3].key == 0x00FFA857);
+    CHECK(events[1].ms < events[2].ms);
+}
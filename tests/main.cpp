@@ -0,0 +1,48 @@
+// Runner of the host tests (see tests/test.h), the step timer interrupt of MotorController is
+// defined here as in the sketch, so tests can run the motors in virtual time.
+//
+//   tests [prefix]
+//
+// Runs the tests whose names start with 'prefix' (all by default), the exit code is the number
+// of failed tests.
+
+#include <string.h>
+
+#include "test.h"
+#include "core/motor_controller.h"
+
+static test::test_t* first = nullptr;
+static test::test_t* last = nullptr;
+static unsigned failures = 0;
+
+void test::add(test_t* test) {
+    if (last) last->next = test;
+    else first = test;
+    last = test;
+}
+
+void test::fail(const char* file, int line, const char* message) {
+    printf("    %s:%d: %s\n", file, line, message);
+    ++failures;
+}
+
+int main(int argc, char* argv[]) {
+
+    const char* prefix = argc > 1 ? argv[1] : "";
+    int failed = 0, count = 0;
+
+    for (test::test_t* t = first; t; t = t->next) {
+        if (strncmp(t->name, prefix, strlen(prefix)) != 0) continue;
+        printf("%s\n", t->name);
+        unsigned before = failures;
+        t->function();
+        if (failures != before) {
+            printf("FAILED %s\n", t->name);
+            ++failed;
+        }
+        ++count;
+    }
+
+    printf("%d of %d tests passed\n", count - failed, count);
+    return count == 0 ? 1 : failed;
+}
@@ -0,0 +1,153 @@
+#define FROM_LIB
+
+#include "test.h"
+#include "core/mount_controller.h"
+
+static MountController mount(MotorController::instance());
+
+struct pole_t { MountController::coord_t pole; float ra_offset; };
+
+static const pole_t aligned_poles[] = {
+    { { 90, 0 },         0 },
+    { { 90, 45 },        10 },
+    { { LATITUDE, 180 }, 0 },
+    { { LATITUDE, 180 }, 33 },
+};
+
+TEST(mount_type) {
+
+    mount.initialize();
+
+    mount.set_mount_pole({ 90, 0 }, 0);
+    CHECK(mount.get_mount_type() == MountController::EQUATORIAL);
+    mount.set_mount_pole({ 90 - POLE_TOLERANCE / 2, 77 }, 5);
+    CHECK(mount.get_mount_type() == MountController::EQUATORIAL);
+
+    // the zenith is at RA 180 of the global coordinates, see _mount_pole
+    mount.set_mount_pole({ LATITUDE, 180 }, 0);
+    CHECK(mount.get_mount_type() == MountController::ALTAZIMUTHAL);
+    mount.set_mount_pole({ LATITUDE, -180 }, 0);
+    CHECK(mount.get_mount_type() == MountController::ALTAZIMUTHAL);
+    mount.set_mount_pole({ LATITUDE, 0 }, 0);
+    CHECK(mount.get_mount_type() == MountController::GENERAL);
+    mount.set_mount_pole({ LATITUDE, 180 + 10 * POLE_TOLERANCE }, 0);
+    CHECK(mount.get_mount_type() == MountController::GENERAL);
+
+    mount.set_mount_pole({ 80, 30 }, 0);
+    CHECK(mount.get_mount_type() == MountController::GENERAL);
+    mount.set_mount_pole({ 90, 0 }, 0, false);
+    CHECK(mount.get_mount_type() == MountController::GENERAL);
+}
+
+TEST(mount_fast_paths) {
+
+    mount.initialize();
+
+    // the fast paths give the same points as the general rotation up to float rounding
+    double max_local = 0, max_global = 0;
+    for (const pole_t& p : aligned_poles) {
+        for (int dec = -80; dec <= 80; dec += 20) {
+            for (int ra = 0; ra < 360; ra += 25) {
+
+                mount.set_mount_pole(p.pole, p.ra_offset);
+                MountController::coord_t fast_local = mount.to_local({ (float)dec, (float)ra });
+                MountController::coord_t fast_global = mount.to_global({ (float)dec, (float)ra });
+
+                mount.set_mount_pole(p.pole, p.ra_offset, false);
+                MountController::coord_t local = mount.to_local({ (float)dec, (float)ra });
+                MountController::coord_t global = mount.to_global({ (float)dec, (float)ra });
+
+                max_local = fmax(max_local, test::distance_arcsec(fast_local.dec, fast_local.ra, local.dec, local.ra));
+                max_global = fmax(max_global, test::distance_arcsec(fast_global.dec, fast_global.ra, global.dec, global.ra));
+            }
+        }
+    }
+
+    printf("    max. difference of fast paths: to_local %.3f\", to_global %.3f\"\n", max_local, max_global);
+    CHECK(max_local < 0.5);
+    CHECK(max_global < 0.5);
+}
+
+TEST(mount_refraction) {
+
+    mount.initialize();
+
+    // refraction lifts every point towards the zenith at {LATITUDE, 180} by the formula of
+    // core/refraction.h, the DEC of an aligned alt-az mount is the altitude and an aligned
+    // equatorial mount sees the global coordinates, and to_global removes the refraction
+    struct { MountController::coord_t pole; boolean fast_paths; } mounts[] = {
+        { { 90, 0 }, true }, { { 90, 0 }, false }, { { LATITUDE, 180 }, true }, { { LATITUDE, 180 }, false },
+    };
+
+    double max_error = 0, max_round_trip = 0;
+    for (auto& m : mounts) {
+        mount.set_mount_pole(m.pole, 0, m.fast_paths);
+        for (int dec = -30; dec <= 85; dec += 5) {
+            for (int ra = 0; ra < 360; ra += 15) {
+
+                double altitude = test::altitude(dec, ra, LATITUDE);
+                if (altitude < 1) continue;
+
+                MountController::coord_t local = mount.to_local({ (float)dec, (float)ra });
+                double apparent = m.pole.dec == 90 ? test::altitude(local.dec, local.ra, LATITUDE) : local.dec;
+                double refraction = (apparent - altitude) * 3600;
+                max_error = fmax(max_error, fabs(refraction - refraction_true_to_apparent(altitude) * 3600));
+
+                MountController::coord_t global = mount.to_global(local);
+                max_round_trip = fmax(max_round_trip, test::distance_arcsec(global.dec, global.ra, dec, ra));
+            }
+        }
+    }
+
+    printf("    max. error of refraction %.3f\", round trip %.3f\"\n", max_error, max_round_trip);
+    CHECK(max_error < 0.5);
+    CHECK(max_round_trip < 1);
+}
+
+TEST(mount_goto_arrival) {
+
+    // The slew aims at the place of the object at the end of the slew (the duration is iterated
+    // until it changes less than GOTO_TIME_TOLERANCE_MS), so the mount standing at the target
+    // at the predicted end of the slew is off by the sky motion of the tolerance and the rounding
+    // to microsteps. The rest is the error of the predicted duration, which the slew model learns.
+    using Dec = MotorController::Dec;
+    using Ra = MotorController::Ra;
+    const double tolerance = GOTO_TIME_TOLERANCE_MS * SIDEREAL_DEG_PER_MS * 3600
+                           + (Dec::REVS_PER_MICROSTEP / Dec::REVS_PER_DEG + Ra::REVS_PER_MICROSTEP / Ra::REVS_PER_DEG) * 3600;
+
+    mount.initialize();
+
+    double max_error = 0, max_late = 0;
+    int arrivals = 0;
+    for (const pole_t& p : aligned_poles) {
+        mount.set_mount_pole(p.pole, p.ra_offset);
+        for (int dec = -20; dec <= 80; dec += 25) {
+            for (int hour_angle = -60; hour_angle <= 60; hour_angle += 30) {
+
+                float ra = fmod(Clock::get_decimal_LST() * 15 - hour_angle + 360, 360);
+                float dec_start, ra_start, dec_end, ra_end;
+                MotorController::instance().get_made_revolutions(dec_start, ra_start);
+                unsigned long start_ms = millis();
+
+                if (!mount.move_absolute(dec, ra)) continue;
+                while (mount.is_moving()) hal::native::advance_micros(1000);
+
+                MotorController::instance().get_made_revolutions(dec_end, ra_end);
+                float planned_ms = MotorController::instance().estimate_fast_turn_time(dec_end - dec_start, ra_end - ra_start);
+                float late_ms = (millis() - start_ms) - planned_ms;
+
+                // a standing mount turns with the sky, its RA at the predicted end was lower by the delay
+                MountController::coord_t now = mount.get_global_mount_orientation();
+                double error = test::distance_arcsec(now.dec, now.ra - late_ms * SIDEREAL_DEG_PER_MS, dec, ra);
+                max_error = fmax(max_error, error);
+                max_late = fmax(max_late, fabs(late_ms));
+                ++arrivals;
+            }
+        }
+    }
+
+    printf("    %d slews, max. error at the predicted arrival %.2f\" (tolerance %.2f\"), max. delay %.0f ms\n",
+           arrivals, max_error, tolerance, max_late);
+    CHECK(arrivals > 50);
+    CHECK(max_error < tolerance);
+}
@@ -0,0 +1,50 @@
+#define FROM_LIB
+
+#include "test.h"
+#include "core/mount_controller.h"
+
+static MountController mount(MotorController::instance());
+
+TEST(rates_jacobian) {
+
+    mount.initialize();
+
+    struct { MountController::coord_t pole; float ra_offset; } poles[] = {
+        { { 90, 0 }, 0 }, { { 89, 40 }, 10 }, { { 80, 300 }, 0 },
+        { { LATITUDE, 180 }, 20 }, { { LATITUDE - 2, 175 }, 0 }, { { 30, 100 }, 50 },
+    };
+
+    // axis rates per degree of global RA against central differences of to_local by 'h' degrees,
+    // which are precise to about 1e-4 relative to the rate (float rounding and the truncation of
+    // the difference), RA rates grow as 1 / cos(DEC) towards the pole of the mount
+    const float h = 0.25f;
+    double max_dec = 0, max_ra = 0;
+    int points = 0;
+
+    for (auto& p : poles) {
+        mount.set_mount_pole(p.pole, p.ra_offset);
+        for (int dec = -60; dec <= 85; dec += 15) {
+            for (int ra = 0; ra < 360; ra += 20) {
+
+                // the refraction table is too coarse for differences near the horizon
+                if (test::altitude(dec, ra, LATITUDE) < 10) continue;
+
+                MountController::coord_t a = mount.to_local({ (float)dec, ra + h });
+                MountController::coord_t b = mount.to_local({ (float)dec, ra - h });
+
+                // RA of the mount is not defined near its pole
+                if (fabs(a.dec) > 80) continue;
+
+                MountController::coord_t rates = mount.get_axis_rates({ (float)dec, (float)ra }, 1);
+                max_dec = fmax(max_dec, fabs(rates.dec - (a.dec - b.dec) / (2 * h)) / fmax(1, fabs(rates.dec)));
+                max_ra = fmax(max_ra, fabs(rates.ra - remainder(a.ra - b.ra, 360) / (2 * h)) / fmax(1, fabs(rates.ra)));
+                ++points;
+            }
+        }
+    }
+
+    printf("    %d points, max. difference of DEC rate %.2g, RA rate %.2g\n", points, max_dec, max_ra);
+    CHECK(points > 300);
+    CHECK(max_dec < 5e-4);
+    CHECK(max_ra < 5e-4);
+}
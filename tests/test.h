@@ -0,0 +1,76 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <math.h>
+
+// Minimal test registry of the native build. Every TEST registers itself at startup, the runner
+// (tests/main.cpp) calls those whose name starts with its argument, CMakeLists.txt registers
+// each group of tests (the prefix before the first '_') with ctest. A failed CHECK prints the
+// expression and the test continues, so all the failures of a test are reported at once.
+//
+//   TEST(trig_sincos) {
+//       CHECK(error < 1e-7);
+//       CHECK_NEAR(value, expected, tolerance);
+//   }
+
+namespace test {
+
+    typedef void (*function_t)();
+
+    struct test_t {
+        const char* name;
+        function_t function;
+        test_t* next;
+    };
+
+    // adds a test to the list of the runner
+    void add(test_t* test);
+
+    // reports a failed check of the running test
+    void fail(const char* file, int line, const char* message);
+
+    struct registrar_t {
+        test_t test;
+        registrar_t(const char* name, function_t function) : test{ name, function, nullptr } { add(&test); }
+    };
+}
+
+namespace test {
+
+    // angle (arc seconds) between two directions given in degrees, computed in double
+    inline double distance_arcsec(double dec_a, double ra_a, double dec_b, double ra_b) {
+        const double rad = M_PI / 180;
+        double x = cos(dec_a * rad) * cos(ra_a * rad) - cos(dec_b * rad) * cos(ra_b * rad);
+        double y = cos(dec_a * rad) * sin(ra_a * rad) - cos(dec_b * rad) * sin(ra_b * rad);
+        double z = sin(dec_a * rad) - sin(dec_b * rad);
+        return 2 * asin(fmin(1.0, sqrt(x * x + y * y + z * z) / 2)) / rad * 3600;
+    }
+
+    // altitude (deg) of a point given in global coordinates (DEC, time dependent RA, the zenith
+    // is at {LATITUDE, 180}, see MountController::_mount_pole)
+    inline double altitude(double dec, double ra, double latitude) {
+        const double rad = M_PI / 180;
+        return asin(sin(dec * rad) * sin(latitude * rad) - cos(dec * rad) * cos(ra * rad) * cos(latitude * rad)) / rad;
+    }
+}
+
+#define TEST(name) \
+    static void test_##name(); \
+    static test::registrar_t registrar_##name(#name, test_##name); \
+    static void test_##name()
+
+#define CHECK(condition) \
+    do { if (!(condition)) test::fail(__FILE__, __LINE__, #condition); } while (0)
+
+#define CHECK_NEAR(value, expected, tolerance) \
+    do { \
+        double value_ = (value), expected_ = (expected); \
+        if (!(fabs(value_ - expected_) <= (tolerance))) { \
+            char message_[160]; \
+            snprintf(message_, sizeof(message_), "%s = %.9g, expected %.9g +- %g", #value, value_, expected_, (double)(tolerance)); \
+            test::fail(__FILE__, __LINE__, message_); \
+        } \
+    } while (0)
+
+#endif
@@ -0,0 +1,137 @@
+#define FROM_LIB
+
+#include "test.h"
+#include "core/mount_controller.h"
+
+#define LOOP_MS     10      // the same as loop() of the sketch
+
+static MountController mount(MotorController::instance());
+
+struct tracking_error_t {
+    double peak = 0;        // arc seconds from the tracked object
+    unsigned long idle = 0; // loops with motors standing still
+};
+
+// runs the main loop for 'seconds' (without calling update() if not 'updating') and samples
+// the distance of the mount from the tracked object every second
+static void run(MountController::coord_t target, unsigned long seconds, bool updating, tracking_error_t& error) {
+    for (unsigned long i = 0; i < seconds * (1000 / LOOP_MS); ++i) {
+        if (updating) mount.update();
+        if (!mount.is_moving()) ++error.idle;
+        hal::native::advance_micros(LOOP_MS * 1000UL);
+        if (i % (1000 / LOOP_MS) == 0) {
+            MountController::coord_t now = mount.get_global_mount_orientation();
+            error.peak = fmax(error.peak, test::distance_arcsec(now.dec, now.ra, target.dec, target.ra));
+        }
+    }
+}
+
+// starts tracking of an object transiting the meridian at DEC 30 in the tracking 'mode'
+static MountController::coord_t start_tracking(MountController::coord_t pole, uint8_t mode = TRACKING_POSITIONS) {
+
+    mount.initialize();
+    mount.set_mount_pole(pole, 0);
+    mount.move_absolute(30, Clock::get_decimal_LST() * 15);
+    while (mount.is_moving()) hal::native::advance_micros(LOOP_MS * 1000UL);
+
+    mount.set_tracking_mode(mode);
+    mount.set_tracking();
+    return mount.get_global_mount_orientation();
+}
+
+TEST(tracking_positions) {
+
+    // The corrections run back to back and the error is bounded by a correction period. Slow
+    // turns used to end early by the fraction of a microstep which is not made, so the motors
+    // stood still between corrections and the tracking ran about 2.5 % ahead of the sky.
+    MountController::coord_t poles[] = { { 90, 0 }, { 88, 30 }, { LATITUDE, 180 } };
+    for (auto pole : poles) {
+        MountController::coord_t target = start_tracking(pole);
+        tracking_error_t error;
+        run(target, 600, true, error);
+        printf("    pole %.0f, %.0f: peak error %.2f\", idle loops %lu\n", pole.dec, pole.ra, error.peak, error.idle);
+        CHECK(mount.is_tracking());
+        CHECK(error.peak < 3);
+        CHECK(error.idle < 5);
+        mount.stop_all();
+    }
+}
+
+TEST(tracking_rates) {
+
+    // The schedule of speeds used to be open loop, slow turns were up to 0.1 % longer and the
+    // fraction of a microstep of each segment was lost, so the error grew by about 50" an hour.
+    MountController::coord_t poles[] = { { 90, 0 }, { 88, 30 }, { LATITUDE, 180 } };
+    for (auto pole : poles) {
+        MountController::coord_t target = start_tracking(pole, TRACKING_RATES);
+        tracking_error_t error;
+        run(target, 1800, true, error);
+        printf("    pole %.0f, %.0f: peak error %.2f\", idle loops %lu\n", pole.dec, pole.ra, error.peak, error.idle);
+        CHECK(mount.is_tracking());
+        CHECK(error.peak < 3);
+        CHECK(error.idle < 5);
+        mount.stop_all();
+    }
+}
+
+TEST(tracking_resync) {
+
+    // motors stop when update() is not called for a while, the tracking must then restart from
+    // the current time instead of replaying the missed schedule, and catch up at most by
+    // TRACKING_MAX_RATE
+    MountController::coord_t target = start_tracking({ 90, 0 });
+    tracking_error_t error;
+    run(target, 60, true, error);
+    run(target, 10, false, error);
+
+    tracking_error_t recovered;
+    run(target, 30, true, error);
+    run(target, 120, true, recovered);
+    printf("    peak error %.2f\" during the break, %.2f\" after the recovery\n", error.peak, recovered.peak);
+    CHECK(mount.is_tracking());
+    CHECK(recovered.peak < 2);
+    CHECK(recovered.idle < 5);
+    mount.stop_all();
+}
+
+static uint64_t step_last;
+static double step_interval, step_jump;
+
+// rising edges of the STEP pin of RA, records the largest change of the period of steps (ms)
+static void record_steps(uint8_t port) {
+    static uint8_t previous = 0;
+    if (((port >> STEP_PIN_RA) & 1) && !((previous >> STEP_PIN_RA) & 1)) {
+        uint64_t now = hal::native::cycles();
+        double interval = (now - step_last) * 1000.0 / F_CPU;
+        if (step_last && step_interval > 0) step_jump = fmax(step_jump, fabs(interval - step_interval));
+        if (step_last) step_interval = interval;
+        step_last = now;
+    }
+    previous = port;
+}
+
+TEST(tracking_steps) {
+
+    // The steps of corrections used to be spread evenly over each of them, so their period
+    // jumped by a whole step per second (from 47.6 to 52.7 ms in sidereal tracking of RA), now
+    // it follows the rate of the object and steps continue across corrections and segments,
+    // the rest is noise of float positions of the object (segments change the rate, which is
+    // noticeable at the transit on alt-az mounts, and DEC of the alt-az mount turns back at the
+    // transit, so only RA is checked)
+    struct { MountController::coord_t pole; uint8_t mode; } cases[] = {
+        { { 90, 0 }, TRACKING_POSITIONS }, { { 90, 0 }, TRACKING_RATES }, { { LATITUDE, 180 }, TRACKING_POSITIONS } };
+    for (auto c : cases) {
+        MountController::coord_t target = start_tracking(c.pole, c.mode);
+        tracking_error_t error;
+        run(target, 5, true, error);
+        step_last = 0;
+        step_interval = step_jump = 0;
+        hal::native::motors_changed = record_steps;
+        run(target, 300, true, error);
+        hal::native::motors_changed = nullptr;
+        printf("    pole %.0f, %.0f, %s: period %.2f ms, jumps by %.3f ms\n", c.pole.dec, c.pole.ra,
+               c.mode == TRACKING_RATES ? "rates" : "positions", step_interval, step_jump);
+        CHECK(step_jump < 1);
+        mount.stop_all();
+    }
+}
@@ -0,0 +1,71 @@
+#include "test.h"
+#include "core/trig.h"
+
+// Accuracy of the trigonometry kernels against libm in double, sweeping whole turns by steps
+// which are not aligned with the sine table. Limits are the documented accuracy (core/trig.h).
+
+static const double RAD = M_PI / 180;
+
+TEST(trig_bam_sincos) {
+
+    double max_error = 0;
+    for (uint32_t i = 0; i < 1000000; ++i) {
+        bam_t angle = i * 4294.967296 * 1.000123;
+        int32_t s, c;
+        bam_sincos(angle, s, c);
+        double a = angle * (2 * M_PI / 4294967296.0);
+        max_error = fmax(max_error, fabs(s / (double)TRIG_ONE - sin(a)));
+        max_error = fmax(max_error, fabs(c / (double)TRIG_ONE - cos(a)));
+    }
+
+    printf("    max. error %.3g\n", max_error);
+    CHECK(max_error < 5e-9);
+}
+
+TEST(trig_bam_atan2) {
+
+    // vectors of many lengths, including short ones, which are normalized
+    double max_error = 0;
+    for (int i = 0; i < 100000; ++i) {
+        double a = (i * 0.0036011 - 180) * RAD;
+        double length = ldexp(1.0, 4 + i % 26);
+        int32_t x = lround(cos(a) * length), y = lround(sin(a) * length);
+        double expected = atan2((double)y, (double)x);
+        double angle = (int32_t)bam_atan2(y, x) * (M_PI / 2147483648.0);
+        max_error = fmax(max_error, fabs(remainder(angle - expected, 2 * M_PI)));
+    }
+
+    printf("    max. error %.3g rad\n", max_error);
+    CHECK(max_error < 1.5e-7);
+}
+
+TEST(trig_fast_float) {
+
+    // float interfaces add rounding of float degrees and values
+    double max_sincos = 0, max_atan2 = 0, max_asin = 0, max_length = 0;
+    for (int i = 0; i < 200000; ++i) {
+
+        float deg = i * 0.0018007f - 180;
+        float s, c;
+        fast_sincos(deg, s, c);
+        max_sincos = fmax(max_sincos, fmax(fabs(s - sin(deg * RAD)), fabs(c - cos(deg * RAD))));
+
+        float x = cos(deg * RAD) * (1 + i % 7), y = sin(deg * RAD) * (1 + i % 7);
+        float length;
+        float angle = fast_atan2(y, x, &length);
+        max_atan2 = fmax(max_atan2, fabs(remainder(angle - atan2((double)y, (double)x) / RAD, 360)) * 3600);
+        max_length = fmax(max_length, fabs(length / hypot((double)x, (double)y) - 1));
+
+        float z = i / 100000.0f - 1;
+        max_asin = fmax(max_asin, fabs(fast_asin(z) - asin((double)z) / RAD) * 3600);
+    }
+
+    printf("    max. error of sincos %.3g, atan2 %.3g\", length %.3g, asin %.3g\"\n", max_sincos, max_atan2, max_length, max_asin);
+    CHECK(max_sincos < 1e-7);
+    CHECK(max_atan2 < 0.1);
+    CHECK(max_length < 1e-6);
+    CHECK(max_asin < 0.1);
+
+    CHECK(fast_atan2(0, 0) == 0);
+    CHECK(fast_asin(1) == 90 && fast_asin(-1) == -90);
+}
@@ -0,0 +1,336 @@
+// Benchmark of the firmware running on the native HAL (src/hal/native). Scripted scenarios run
+// in virtual time and the host time spent in the step interrupt, the main loop and selected
+// functions is measured, so changes of the stepper, mount or catalogue code can be judged by
+// numbers. Times are host nanoseconds, so compare them between builds on the same machine.
+//
+//   benchmark [-sd directory] [scenario ...]
+//
+// Scenarios are slew, tracking, catalogue, alignment, display and functions (all by default).
+
+#define FROM_LIB
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "control/control.h"
+#include "core/canon_eos1000d.h"
+#include "core/rtc_ds3231.h"
+#include "core/refraction.h"
+#include "core/trig.h"
+
+#ifndef BENCHMARK_SD_DIR
+#define BENCHMARK_SD_DIR "SD"
+#endif
+
+#define LOOP_DELAY_MS 10    // the same as loop() of the sketch
+
+struct stats_t {
+
+    const char* name;
+    unsigned long count;
+    double min, max, total;
+
+    stats_t(const char* n) : name(n) { reset(); }
+
+    void reset() { count = 0; min = max = total = 0; }
+
+    void add(double ns) {
+        if (count == 0 || ns < min) min = ns;
+        if (count == 0 || ns > max) max = ns;
+        total += ns;
+        ++count;
+    }
+
+    void print() {
+        if (count == 0) printf("  %-34s %10s\n", name, "-");
+        else printf("  %-34s %10lu %12.0f %12.0f %12.0f\n", name, count, min, total / count, max);
+    }
+};
+
+static RtcDS3231 rtc;
+static CanonEOS1000D camera;
+static MountController mount(MotorController::instance());
+static Control control(mount, camera, rtc);
+
+static stats_t isr_stats("MotorController::trigger()");
+static stats_t loop_stats("Control::update()");
+static double timer_overhead = 0;
+
+static inline double now_ns() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+HAL_TIMER_ISR {
+    double start = now_ns();
+    Log::isr_begin();
+    MotorController::instance().trigger();
+    IrReceiver::sample();
+    Log::isr_end();
+    isr_stats.add(max(0.0, now_ns() - start - timer_overhead));
+}
+
+// runs the main loop for 'ms' of virtual time, the time of the interrupts is not counted to loop
+static void run(unsigned long ms, stats_t& loop = loop_stats) {
+    unsigned long start = millis();
+    while (millis() - start < ms) {
+        double isr_before = isr_stats.total;
+        double begin = now_ns();
+        control.update();
+        loop.add(max(0.0, now_ns() - begin - timer_overhead - (isr_stats.total - isr_before)));
+        delay(LOOP_DELAY_MS);
+    }
+}
+
+// holds a key of the remote for 'hold_ms' and lets the firmware notice the release
+static void tap(uint32_t key, unsigned long hold_ms = 300, stats_t& loop = loop_stats) {
+    hal::native::ir_press(key);
+    run(hold_ms, loop);
+    hal::native::ir_release();
+    run(2 * IR_RELEASE_MS, loop);
+}
+
+static void print_header(const char* scenario) {
+    printf("\n%s\n  %-34s %10s %12s %12s %12s\n", scenario, "host ns", "calls", "min", "mean", "max");
+}
+
+static void print_loads() {
+    double firmware = isr_stats.total + loop_stats.total;
+    if (firmware > 0) printf("  ISR share of firmware time: %.1f %%\n", 100.0 * isr_stats.total / firmware);
+}
+
+static void reset_stats() {
+    isr_stats.reset();
+    loop_stats.reset();
+}
+
+static void scenario_slew() {
+
+    reset_stats();
+
+    auto start = mount.get_global_mount_orientation();
+    unsigned long start_ms = millis();
+    if (!mount.move_absolute(45, fmod(start.ra + 150, 360))) {
+        printf("\nslew\n  refused by the mount\n");
+        return;
+    }
+    while (mount.is_moving() && millis() - start_ms < 600000UL) run(100);
+
+    print_header("slew (150 deg in RA, to DEC 45)");
+    isr_stats.print();
+    loop_stats.print();
+    print_loads();
+    printf("  slew duration: %.1f s\n", (millis() - start_ms) / 1000.0);
+}
+
+static void scenario_tracking() {
+
+    reset_stats();
+
+    mount.set_tracking();
+    run(10 * 60000UL);
+    mount.stop_all();
+
+    print_header("tracking (10 minutes)");
+    isr_stats.print();
+    loop_stats.print();
+    print_loads();
+}
+
+static void scenario_catalogue() {
+
+    stats_t lookup_stats("Control::update() with lookup");
+    reset_stats();
+
+    tap(C_MESSIER);
+    tap(C_N3);
+    tap(C_N1);
+    tap(C_ENTER, 300, lookup_stats);
+    tap(C_ENTER);
+    bool found = mount.is_moving();
+    mount.stop_all();
+
+    print_header("catalogue (Messier 31)");
+    loop_stats.print();
+    lookup_stats.print();
+    printf("  object %s\n", found ? "found" : "not found");
+}
+
+static void scenario_alignment() {
+
+    MountController::coord_t pole;
+    float ra_offset;
+    mount.get_mount_pole(pole, ra_offset);
+
+    // stars seen by a mount with the pole 1 degree off
+    MountController::coord_t kernel[4] = { { 20, 30 }, { 60, 120 }, { -10, 200 }, { 40, 300 } };
+    MountController::coord_t image[4];
+    for (int i = 0; i < 4; ++i) image[i] = { kernel[i].dec + cosf(kernel[i].ra * (float)DEG_TO_RAD), kernel[i].ra };
+
+    stats_t alignment_stats("all_star_alignment(4 pairs)");
+    double begin = now_ns();
+    mount.all_star_alignment(kernel, image, 4);
+    alignment_stats.add(now_ns() - begin);
+
+    mount.set_mount_pole(pole, ra_offset);
+
+    print_header("alignment");
+    alignment_stats.print();
+}
+
+template <class F>
+static void measure(const char* name, int count, F function) {
+    stats_t stats(name);
+    for (int i = 0; i < count; ++i) {
+        double begin = now_ns();
+        function(i);
+        stats.add(max(0.0, now_ns() - begin - timer_overhead));
+    }
+    stats.print();
+}
+
+static void scenario_display() {
+
+    Display display;
+    display.initialize(128);
+
+    int ra[3] = { 12, 34, 56 };
+    int dec[3] = { -45, 12, 34 };
+    char type[6] = "GX";
+
+    print_header("display");
+    measure("render_main (refresh)", 1000, [&](int) {
+        display.render_main(true, S0, Clock::get_LST(), true, false, false);
+    });
+    measure("render_main", 1000, [&](int) {
+        display.render_main(false, S0, Clock::get_LST(), true, false, false);
+    });
+    measure("render_goto (refresh)", 1000, [&](int) { display.render_goto(true, S1, ra, dec); });
+    measure("render_position (refresh)", 1000, [&](int) { display.render_position(true, 123.456f, -45.678f); });
+    measure("render_catalogue_results", 1000, [&](int) {
+        display.render_catalogue_results(true, S0, 31, 3.4f, 178.0f, 63.0f, type);
+    });
+}
+
+static void scenario_functions() {
+
+    print_header("functions");
+    measure("Clock::get_LST_angle", 100000, [](int) { Clock::get_LST_angle(); });
+    measure("get_global_mount_orientation", 100000, [](int) { mount.get_global_mount_orientation(); });
+    measure("get_local_mount_orientation", 100000, [](int) { mount.get_local_mount_orientation(); });
+    measure("J2000_to_apparent", 100000, [](int i) {
+        mount.J2000_to_apparent(MountController::coord_t { (float)(i % 180 - 90), (float)(i % 360) });
+    });
+    measure("refraction_true_to_apparent", 100000, [](int i) { refraction_true_to_apparent(i % 90); });
+}
+
+// kernels of core/trig.h against libm (float), results are stored to 'sink' so none is optimized out
+static volatile float sink;
+
+static void scenario_trig() {
+
+    print_header("trig");
+    measure("fast_sincos", 100000, [](int i) { float s, c; fast_sincos(i * 0.0036f, s, c); sink = s + c; });
+    measure("sin + cos", 100000, [](int i) { float a = i * 0.0036f * (float)(M_PI / 180); sink = sinf(a) + cosf(a); });
+    measure("fast_atan2", 100000, [](int i) { sink = fast_atan2(i % 201 - 100.0f, i % 97 + 1.0f); });
+    measure("atan2", 100000, [](int i) { sink = atan2f(i % 201 - 100.0f, i % 97 + 1.0f) * (float)(180 / M_PI); });
+    measure("fast_asin", 100000, [](int i) { sink = fast_asin(i % 2001 / 1000.0f - 1); });
+    measure("asin", 100000, [](int i) { sink = asinf(i % 2001 / 1000.0f - 1) * (float)(180 / M_PI); });
+}
+
+// conversions of the aligned equatorial and alt-az mounts by their fast paths and by the general
+// rotation (which a misaligned pole uses), the pole is restored at the end
+static void scenario_transforms() {
+
+    MountController::coord_t pole;
+    float ra_offset;
+    mount.get_mount_pole(pole, ra_offset);
+
+    struct { const char* name; MountController::coord_t pole; } mounts[] = {
+        { "equatorial", { 90, 0 } },
+        { "alt-az", { LATITUDE, 180 } },
+    };
+
+    print_header("transforms");
+    for (auto& m : mounts) {
+        for (int fast = 1; fast >= 0; --fast) {
+            char name[64];
+            mount.set_mount_pole(m.pole, 0, fast);
+            snprintf(name, sizeof(name), "to_local (%s, %s)", m.name, fast ? "fast" : "general");
+            measure(name, 100000, [](int i) { mount.to_local({ (float)(i % 180 - 90), (float)(i % 360) }); });
+            snprintf(name, sizeof(name), "to_global (%s, %s)", m.name, fast ? "fast" : "general");
+            measure(name, 100000, [](int i) { mount.to_global({ (float)(i % 180 - 90), (float)(i % 360) }); });
+        }
+    }
+
+    mount.set_mount_pole(pole, ra_offset);
+}
+
+// the general conversion to local coordinates (polar to cartesian, the rotation and back) in each
+// scalar type MOUNT_REAL can be, the pointing error of each is checked by the coords_ tests
+template <class T>
+static void measure_precision(const char* name) {
+
+    T sd, cd, sr, cr;
+    scalar_math<T>::sin_cos(52.3f, sd, cd);
+    scalar_math<T>::sin_cos(171.7f, sr, cr);
+    T zero = 0.0f, one = 1.0f;
+    static matrix<T> rotation;
+    rotation = matrix<T> {{{ sd, zero, -cd }, { zero, one, zero }, { cd, zero, sd }}}
+             * matrix<T> {{{ cr, sr, zero }, { -sr, cr, zero }, { zero, zero, one }}};
+
+    measure(name, 100000, [](int i) {
+        polar_t local = cartesian_to_polar(rotation * polar_to_cartesian<T>({ (float)(i % 180 - 90), (float)(i % 360) }));
+        sink = local.dec + local.ra;
+    });
+}
+
+static void scenario_precision() {
+
+    print_header("precision");
+    measure_precision<float>("to local (float)");
+    measure_precision<double>("to local (double)");
+    measure_precision<fixed_t>("to local (fixed_t)");
+}
+
+int main(int argc, char* argv[]) {
+
+    const char* sd = BENCHMARK_SD_DIR;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-sd") == 0) {
+        sd = argv[2];
+        first = 3;
+    }
+    hal::native::set_storage_root(sd);
+
+    // the cost of reading the host clock is subtracted from all measurements
+    timer_overhead = 1e9;
+    for (int i = 0; i < 10000; ++i) {
+        double begin = now_ns();
+        timer_overhead = min(timer_overhead, now_ns() - begin);
+    }
+
+    control.initialize();
+    run(1000);
+
+    struct { const char* name; void (*run)(); } scenarios[] = {
+        { "slew", scenario_slew },
+        { "tracking", scenario_tracking },
+        { "catalogue", scenario_catalogue },
+        { "alignment", scenario_alignment },
+        { "display", scenario_display },
+        { "functions", scenario_functions },
+        { "trig", scenario_trig },
+        { "transforms", scenario_transforms },
+        { "precision", scenario_precision },
+    };
+
+    for (auto& scenario : scenarios) {
+        bool selected = first == argc;
+        for (int i = first; i < argc; ++i) selected |= strcmp(argv[i], scenario.name) == 0;
+        if (selected) scenario.run();
+    }
+
+    return 0;
+}
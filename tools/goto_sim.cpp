@@ -0,0 +1,97 @@
+// Fast forward simulation of GOTO durations. The firmware (the slew planner of MountController
+// with the step generator of MotorController) runs on the native HAL in virtual time and slews
+// through a list of random targets, one after another, as in a session of visual observing. The
+// duration of each GOTO is the virtual time until the mount stops, so it includes acceleration
+// and the iteration of the moving target, not just the estimate of the slew model.
+//
+//   goto_sim [targets] [seed] [RA offset]
+//
+// Targets (2000 by default) are spread evenly over the sky above MIN_ALTITUDE of the time of
+// their GOTO, and the same seed gives the same list on any host. The mount is equatorial, its
+// RA offset (0 by default) puts the ends of the RA range at the lower culmination, 180 puts them
+// at the meridian, where the cables of a mount limited to 0..360 hurt most. The axis limits are
+// those the firmware is built with (RA_LIMIT_xxx and DEC_LIMIT_xxx of config.h), so the native
+// build makes goto_sim for the defaults and goto_sim_wrap and goto_sim_flip with wider limits,
+// and the goto_comparison target runs all of them with both RA offsets.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <random>
+
+#include "config.h"
+#include "core/mount_controller.h"
+#include "core/rtc_ds3231.h"
+
+#define LOOP_MS         10      // the same as loop() of the sketch
+#define MIN_ALTITUDE    10      // targets below this altitude (deg) are drawn again
+
+static const double RAD = M_PI / 180.0;
+
+static RtcDS3231 rtc;
+static MountController mount(MotorController::instance());
+
+static double seconds() { return hal::native::cycles() / (double)F_CPU; }
+
+// altitude (deg) of a point with equatorial coordinates 'dec' and 'ra' (deg) now
+static double altitude(double dec, double ra) {
+    double hour_angle = Clock::get_decimal_LST() * 15.0 - ra;
+    return asin(sin(LATITUDE * RAD) * sin(dec * RAD) + cos(LATITUDE * RAD) * cos(dec * RAD) * cos(hour_angle * RAD)) / RAD;
+}
+
+int main(int argc, char* argv[]) {
+
+    long targets = argc > 1 ? atol(argv[1]) : 2000;
+    unsigned long seed = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1;
+    float ra_offset = argc > 3 ? atof(argv[3]) : 0;
+    if (targets <= 0) {
+        fprintf(stderr, "usage: %s [targets] [seed] [RA offset]\n", argv[0]);
+        return 2;
+    }
+
+    // raw outputs of mt19937 are the same everywhere, unlike the distributions of the library
+    std::mt19937 random(seed);
+    auto uniform = [&random]() { return random() / 4294967296.0; };
+
+    rtc.sync(DateTime(2026, 10, 18, 20, 0, 0));
+    mount.initialize();
+    mount.set_mount_pole({ 90, 0 }, ra_offset);
+
+    double total = 0, longest = 0;
+    long slews = 0, refused = 0, flipped = 0, wrapped = 0;
+
+    for (long i = 0; i < targets; ++i) {
+
+        double dec, ra;
+        do {
+            dec = asin(2 * uniform() - 1) / RAD;
+            ra = 360 * uniform();
+        } while (altitude(dec, ra) < MIN_ALTITUDE);
+
+        double start = seconds();
+        if (!mount.move_absolute(dec, ra)) {
+            ++refused;
+            continue;
+        }
+        while (mount.is_moving()) {
+            mount.update();
+            hal::native::advance_micros(LOOP_MS * 1000UL);
+        }
+
+        double duration = seconds() - start;
+        total += duration;
+        longest = max(longest, duration);
+        ++slews;
+
+        MountController::coord_t axes = mount.get_local_mount_orientation();
+        if (axes.dec > 90 || axes.dec < -90) ++flipped;
+        if (axes.ra > 360 || axes.ra < 0) ++wrapped;
+    }
+
+    printf("limits RA %d..%d, DEC %d..%d, RA offset %.0f, %ld targets above %d deg, latitude %.2f, seed %lu\n",
+           RA_LIMIT_MIN, RA_LIMIT_MAX, DEC_LIMIT_MIN, DEC_LIMIT_MAX, ra_offset, targets, MIN_ALTITUDE, LATITUDE, seed);
+    printf("  mean GOTO %.1f s, longest %.1f s, over the pole %ld, RA beyond 0..360 %ld, refused %ld\n",
+           slews ? total / slews : 0, longest, flipped, wrapped, refused);
+
+    return 0;
+}
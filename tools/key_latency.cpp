@@ -0,0 +1,181 @@
+// Latency of the user interface from a key of the remote to its effect. Keys are scripted
+// presses of the emulated NEC remote of the native HAL (the frame of the key takes 67.5 ms, then
+// repeat frames start every 108 ms until the release), whose pulses the IR receiver decodes in
+// the step timer interrupt as on the board, so the whole path of the decoder, its release
+// timeout, Keypad::update, Control::update, loop() with its delay and the hold time of pressed
+// keys is measured. The effect is the first STEP edge of a motor or the first clear of the
+// display (every screen redrawn because of a key starts by it, periodic refreshes of values do
+// not clear it).
+//
+//   key_latency [phases]
+//
+// Every scenario is repeated with the key pressed at 'phases' offsets (20 by default) spread over
+// a period of loop(), once with a fresh Control and once after another key, and the virtual time from
+// the press and from the release of the key to the effect is printed (min, mean and max in ms).
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "config.h"
+#include "control/control.h"
+#include "core/canon_eos1000d.h"
+#include "core/rtc_ds3231.h"
+
+#define LOOP_MS         10      // the same as loop() of the sketch
+#define IDLE_MS         1000    // idle time after the initialization and before the key
+#define TIMEOUT_MS      3000    // the longest wait for the effect after the release
+#define WARM_UP_KEY     C_N9    // a key without effect in the main menu
+
+struct scenario_t {
+    const char* name;
+    uint32_t setup_key;     // pushed before the measured key (0 for none)
+    uint32_t key;
+    unsigned long hold_ms;
+    bool motion;            // the effect is a STEP edge, otherwise a clear of the display
+};
+
+static const scenario_t scenarios[] = {
+    { "GOTO menu (push D)",         0,       C_GOTO,      300,  false },
+    { "help menu (hold EXIT)",      0,       C_EXIT,      1000, false },
+    { "manual 1 deg (push UP)",     C_ENTER, C_ARROW_UP,  300,  true  },
+    { "manual 5 deg (hold UP)",     C_ENTER, C_ARROW_UP,  1000, true  },
+    { "tracking (hold OK)",         0,       C_TRACKING,  1000, true  },
+};
+
+struct latency_t {
+    unsigned long count = 0, missed = 0;
+    double min_press = 0, max_press = 0, sum_press = 0;
+    double min_release = 0, max_release = 0, sum_release = 0;
+
+    void add(double press_ms, double release_ms) {
+        if (count == 0 || press_ms < min_press) min_press = press_ms;
+        if (count == 0 || press_ms > max_press) max_press = press_ms;
+        if (count == 0 || release_ms < min_release) min_release = release_ms;
+        if (count == 0 || release_ms > max_release) max_release = release_ms;
+        sum_press += press_ms;
+        sum_release += release_ms;
+        ++count;
+    }
+};
+
+static RtcDS3231 rtc;
+static CanonEOS1000D camera;
+static MountController mount(MotorController::instance());
+
+static const uint8_t step_mask = (1 << STEP_PIN_DEC) | (1 << STEP_PIN_RA);
+
+// virtual time of the first effect since the key was pressed (0 if none yet)
+static uint64_t effect_cycles = 0;
+static uint8_t last_port = 0;
+static bool watch_motion = false;
+static bool watch_display = false;
+
+static void on_motors(uint8_t port) {
+    if (watch_motion && effect_cycles == 0 && ((port ^ last_port) & step_mask)) effect_cycles = hal::native::cycles();
+    last_port = port;
+}
+
+static void on_lcd(bool cleared) {
+    if (watch_display && cleared && effect_cycles == 0) effect_cycles = hal::native::cycles();
+}
+
+static double to_ms(uint64_t cycles) { return cycles / (F_CPU / 1000.0); }
+
+static void run(Control& control, unsigned long ms) {
+    unsigned long start = millis();
+    while (millis() - start < ms) {
+        control.update();
+        delay(LOOP_MS);
+    }
+}
+
+static void tap(Control& control, uint32_t key, unsigned long hold_ms = 300) {
+    hal::native::ir_press(key);
+    run(control, hold_ms);
+    hal::native::ir_release();
+    run(control, 2 * IR_RELEASE_MS);
+}
+
+// returns false if the key had no effect
+static bool measure(const scenario_t& scenario, bool warm, unsigned long phase_us, double& press_ms, double& release_ms) {
+
+    mount.stop_all();
+    hal::native::ir_release();
+
+    Control control(mount, camera, rtc);
+    control.initialize();
+
+    if (warm) tap(control, WARM_UP_KEY);
+    if (scenario.setup_key) tap(control, scenario.setup_key);
+    run(control, IDLE_MS);
+
+    // the key is pressed 'phase_us' after a call of Control::update, during the delay of loop()
+    control.update();
+    hal::native::advance_micros(phase_us);
+
+    last_port = hal::motors_read();
+    effect_cycles = 0;
+    watch_motion = scenario.motion;
+    watch_display = !scenario.motion;
+
+    uint64_t press = hal::native::cycles();
+    hal::native::ir_press(scenario.key);
+    hal::native::advance_micros(LOOP_MS * 1000UL - phase_us);
+    run(control, scenario.hold_ms - LOOP_MS);
+    uint64_t release = hal::native::cycles();
+    hal::native::ir_release();
+
+    unsigned long start = millis();
+    while (effect_cycles == 0 && millis() - start < TIMEOUT_MS) run(control, LOOP_MS);
+
+    watch_motion = watch_display = false;
+    if (effect_cycles == 0) return false;
+
+    press_ms = to_ms(effect_cycles - press);
+    release_ms = to_ms(effect_cycles) - to_ms(release);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+
+    int phases = argc > 1 ? atoi(argv[1]) : 20;
+    if (phases <= 0) {
+        fprintf(stderr, "usage: %s [phases]\n", argv[0]);
+        return 2;
+    }
+
+    hal::native::motors_changed = on_motors;
+    hal::native::lcd_changed = on_lcd;
+    rtc.sync(DateTime(2026, 10, 18, 20, 0, 0));
+
+    printf("key to effect latency (ms of virtual time), %d phases over loop() every %d ms\n\n", phases, LOOP_MS);
+    printf("%-26s %-7s %-7s %26s %26s\n", "scenario", "keypad", "effect", "from press min/mean/max", "from release min/mean/max");
+
+    for (const scenario_t& scenario : scenarios) {
+        for (int warm = 0; warm < 2; ++warm) {
+
+            // the setup key already used the keypad
+            if (warm && scenario.setup_key) continue;
+
+            latency_t latency;
+            for (int i = 0; i < phases; ++i) {
+                double press_ms, release_ms;
+                if (measure(scenario, warm, i * LOOP_MS * 1000UL / phases, press_ms, release_ms)) latency.add(press_ms, release_ms);
+                else ++latency.missed;
+            }
+
+            printf("%-26s %-7s %-7s", scenario.name, warm || scenario.setup_key ? "used" : "fresh", scenario.motion ? "STEP" : "LCD");
+            if (latency.count == 0) {
+                printf(" %26s\n", "no effect");
+                continue;
+            }
+            printf("   %7.1f %7.1f %7.1f   %7.1f %7.1f %7.1f", latency.min_press, latency.sum_press / latency.count, latency.max_press,
+                   latency.min_release, latency.sum_release / latency.count, latency.max_release);
+            if (latency.missed) printf("  (%lu missed)", latency.missed);
+            printf("\n");
+            fflush(stdout);
+        }
+    }
+
+    return 0;
+}
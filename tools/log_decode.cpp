@@ -0,0 +1,163 @@
+// Decoder of the binary log of the firmware (see src/core/log.h). It reads the serial output of
+// the board, prints records as text lines with their time (seconds from the first record) and
+// passes other bytes (e.g. the runtime stats) through as they are.
+//
+//   log_decode [file]
+//
+// The standard input is read without a file, e.g. the board itself:
+//
+//   stty -F /dev/ttyACM0 115200 raw && log_decode /dev/ttyACM0
+//
+// Records carry just 16 bits of millis, so the time is exact unless there is a gap of more
+// than 32 seconds without any record.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "core/log.h"
+
+#define LOG_EVENT_FORMAT(id, format) format,
+static const char* formats[] = { LOG_EVENTS(LOG_EVENT_FORMAT) };
+#undef LOG_EVENT_FORMAT
+
+class Input {
+
+    public:
+
+        Input(FILE* file) : _file(file) {}
+
+        // returns true if there are at least 'n' bytes from the position
+        bool has(size_t n) {
+            while (_buffer.size() - _position < n) {
+                int c = fgetc(_file);
+                if (c == EOF) return false;
+                _buffer.push_back(c);
+            }
+            return true;
+        }
+
+        uint8_t at(size_t i) const { return _buffer[_position + i]; }
+
+        void skip(size_t n) {
+            _position += n;
+            if (_position > 4096) {
+                _buffer.erase(_buffer.begin(), _buffer.begin() + _position);
+                _position = 0;
+            }
+        }
+
+    private:
+
+        FILE* _file;
+        std::vector<uint8_t> _buffer;
+        size_t _position = 0;
+};
+
+// prints the arguments by the format, missing arguments are printed as '?'
+static void print_record(const char* format, const uint8_t* args, size_t length) {
+
+    size_t offset = 0;
+
+    for (const char* c = format; *c; ++c) {
+
+        if (*c != '%') {
+            putchar(*c);
+            continue;
+        }
+
+        // the conversion with its flags, width and precision
+        char spec[16] = "%";
+        size_t spec_length = 1;
+        while (*++c && !strchr("dufxs%", *c) && spec_length < sizeof(spec) - 3) spec[spec_length++] = *c;
+        if (!*c) break;
+
+        if (*c == '%') {
+            putchar('%');
+            continue;
+        }
+
+        if (*c == 's') {
+            if (offset >= length || offset + 1 + args[offset] > length) { putchar('?'); continue; }
+            spec[spec_length++] = '.';
+            spec[spec_length++] = '*';
+            spec[spec_length++] = 's';
+            printf(spec, (int)args[offset], (const char*)args + offset + 1);
+            offset += 1 + args[offset];
+            continue;
+        }
+
+        if (offset + 4 > length) { putchar('?'); continue; }
+        uint32_t word = args[offset] | args[offset + 1] << 8 | args[offset + 2] << 16 | (uint32_t)args[offset + 3] << 24;
+        offset += 4;
+
+        if (*c == 'f') {
+            float value;
+            memcpy(&value, &word, 4);
+            spec[spec_length++] = 'f';
+            printf(spec, (double)value);
+        }
+        else {
+            spec[spec_length++] = 'l';
+            spec[spec_length++] = *c;
+            if (*c == 'd') printf(spec, (long)(int32_t)word);
+            else printf(spec, (unsigned long)word);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    FILE* file = argc > 1 ? fopen(argv[1], "rb") : stdin;
+    if (!file) {
+        fprintf(stderr, "usage: %s [file]\n", argv[0]);
+        return 2;
+    }
+
+    Input input(file);
+    bool first = true;
+    bool line_start = true;
+    uint16_t last_ms = 0;
+    long long time_ms = 0;
+
+    while (input.has(1)) {
+
+        uint8_t byte = input.at(0);
+
+        // a record has a valid header and all its arguments, anything else is text
+        bool record = byte == LOG_SYNC && input.has(LOG_HEADER_SIZE) && input.at(1) < LOG_EVENTS_COUNT &&
+                      input.at(2) <= LOG_RECORD_MAX - LOG_HEADER_SIZE && input.has(LOG_HEADER_SIZE + input.at(2));
+
+        if (!record) {
+            putchar(byte);
+            line_start = byte == '\n';
+            input.skip(1);
+            continue;
+        }
+
+        uint16_t ms = input.at(3) | input.at(4) << 8;
+        if (first) last_ms = ms;
+        first = false;
+
+        // records of the interrupt and the main loop may come slightly out of order
+        time_ms += (int16_t)(ms - last_ms);
+        last_ms = ms;
+
+        uint8_t length = input.at(2);
+        uint8_t args[LOG_RECORD_MAX];
+        for (uint8_t i = 0; i < length; ++i) args[i] = input.at(LOG_HEADER_SIZE + i);
+
+        if (!line_start) putchar('\n');
+        printf("[%10.3f] ", time_ms / 1000.0);
+        print_record(formats[input.at(1)], args, length);
+        putchar('\n');
+        line_start = true;
+
+        input.skip(LOG_HEADER_SIZE + length);
+        fflush(stdout);
+    }
+
+    if (file != stdin) fclose(file);
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+#!/bin/sh
+# RAM and flash budget of the Mega firmware: totals of the sections and the largest symbols of
+# both memories. The static RAM (.data, .bss) and the stack and heap share the 8 KB, compare the
+# rest with "RAM free min" of the runtime stats (it shows how close the stack came to the heap).
+#
+#   tools/memory_report.sh [firmware.elf] [symbols]
+#
+# Without the ELF file the sketch is compiled by arduino-cli for arduino:avr:mega first. The 30
+# largest symbols of each memory are listed by default. NM and SIZE select other binutils.
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+ELF=$1
+SYMBOLS=${2:-30}
+NM=${NM:-avr-nm}
+SIZE=${SIZE:-avr-size}
+
+RAM_SIZE=8192
+FLASH_SIZE=253952   # 256 KB without the 8 KB bootloader
+
+if [ -z "$ELF" ]; then
+    BUILD="$ROOT/build/firmware"
+    mkdir -p "$BUILD"
+    arduino-cli compile --fqbn arduino:avr:mega --build-path "$BUILD" "$ROOT" > /dev/null
+    ELF="$BUILD/Star_Tracker.ino.elf"
+fi
+
+$SIZE -A "$ELF" | awk -v ram="$RAM_SIZE" -v flash="$FLASH_SIZE" '
+    $1 == ".text" { text = $2 }
+    $1 == ".data" { data = $2 }
+    $1 == ".bss" { bss = $2 }
+    $1 == ".noinit" { noinit = $2 }
+    END {
+        static = data + bss + noinit
+        printf "flash: %6d of %6d bytes (%4.1f %%), .text %d + .data %d\n", text + data, flash, 100 * (text + data) / flash, text, data
+        printf "RAM:   %6d of %6d bytes (%4.1f %%), .data %d + .bss %d + .noinit %d\n", static, ram, 100 * static / ram, data, bss, noinit
+        printf "       %6d bytes are left for the heap and the stack\n", ram - static
+    }'
+
+# symbols with sizes, the largest first, "b d" are in RAM, "t r" in flash (initial values of
+# "d" are in flash too, but they are counted in .data above)
+report() {
+    echo
+    echo "$1"
+    $NM -C -S --size-sort -r --radix=d "$ELF" | awk -v types="$2" -v count="$SYMBOLS" '
+        NF >= 4 && index(types, tolower($3)) && shown < count {
+            name = $4
+            for (i = 5; i <= NF; ++i) name = name " " $i
+            printf "  %6d  %s  %s\n", $2, $3, name
+            ++shown
+        }'
+}
+
+report "largest symbols in RAM (bytes, type, name):" "bdv"
+report "largest symbols in flash (bytes, type, name):" "tr"
@@ -0,0 +1,463 @@
+// Step traces of MotorController running on the native HAL (src/hal/native). A scenario is
+// recorded in virtual time as every change of the STEP, DIR and MS pins with its timestamp
+// and the analyzer reports intervals of steps, their jitter, the rate error of slow turns
+// against the commanded rate, the conformance of fast turns to the acceleration profile and
+// the final position of both axes. Traces can be converted to VCD files for GTKWave.
+//
+//   step_trace record trace.txt tracking [seconds]     sidereal tracking of RA (600 s)
+//   step_trace record trace.txt slew [dec_deg ra_deg]  fast turn of axes (30 and 90 deg)
+//   step_trace analyze trace.txt
+//   step_trace vcd trace.txt trace.vcd
+//
+// A trace is a text file of "<CPU cycles> <motors port in hex>" lines, lines starting with '#'
+// describe the commanded movement and the balance of MotorController at the end. Interrupts
+// of the emulated board take no time, so the jitter comes from the step generator alone.
+
+#include <map>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "core/motor_controller.h"
+
+using Dec = MotorController::Dec;
+using Ra = MotorController::Ra;
+
+#define GAP_CYCLES      F_CPU   // steps more than a second apart belong to different movements
+#define HISTOGRAM_BINS  12      // the most frequent intervals printed for each movement
+
+static FILE* output = nullptr;
+
+static void record_port(uint8_t port) {
+    fprintf(output, "%llu %02x\n", (unsigned long long)hal::native::cycles(), port);
+}
+
+// queues slow turns of RA as MountController::update_tracking does, called every 10 ms as by
+// the main loop of the sketch
+static void record_tracking(MotorController& motors, float seconds) {
+
+    double revs_per_ms = SIDEREAL_DEG_PER_MS * Ra::REVS_PER_DEG;
+    unsigned long end_ms = seconds * 1000;
+
+    fprintf(output, "# rate ra %.6f\n", revs_per_ms * 1000.0 * Ra::MICROSTEPS_PER_REV);
+
+    unsigned long scheduled_ms = 0;
+
+    while (millis() < end_ms) {
+
+        #if TRACKING_MODE == TRACKING_POSITIONS
+
+            // the next movement ends where the sky will be at the end of the schedule
+            if (motors.queued_commands() == 0) {
+                scheduled_ms = millis() + motors.get_remaining_ms() + TRACKING_CORRECTION_MS;
+
+                Dec::pulses_t dec;
+                Ra::pulses_t ra;
+                motors.get_target_pulses(dec, ra);
+                float revs = revs_per_ms * scheduled_ms - Ra::pulses_to_revs(ra);
+                motors.slow_turn(0, revs, 0, fabs(revs) * 1000.0f / TRACKING_CORRECTION_MS, true);
+            }
+
+        #else
+
+            while (motors.queued_commands() < TRACKING_SEGMENTS_AHEAD) {
+                float revs = revs_per_ms * TRACKING_SEGMENT_MS;
+                motors.slow_turn(0, revs, 0, revs * 1000.0f / TRACKING_SEGMENT_MS, true);
+                scheduled_ms += TRACKING_SEGMENT_MS;
+            }
+
+        #endif
+
+        hal::native::advance_micros(10000);
+    }
+}
+
+static void record_slew(MotorController& motors, float dec_deg, float ra_deg) {
+
+    Dec::revs_t dec = Dec::deg_to_revs(dec_deg);
+    Ra::revs_t ra = Ra::deg_to_revs(ra_deg);
+
+    fprintf(output, "# slew dec %lu\n", (unsigned long)Dec::revs_to_steps(dec, false));
+    fprintf(output, "# slew ra %lu\n", (unsigned long)Ra::revs_to_steps(ra, false));
+
+    motors.fast_turn(dec, ra, false);
+    while (!motors.is_ready() || motors.queued_commands() > 0) hal::native::advance_micros(10000);
+}
+
+static int record(int argc, char* argv[]) {
+
+    if (argc < 4) return -1;
+
+    output = fopen(argv[2], "w");
+    if (!output) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    MotorController& motors = MotorController::instance();
+    motors.initialize();
+
+    fprintf(output, "# cpu_hz %lu\n", (unsigned long)F_CPU);
+    record_port(hal::native::motors_port);
+    hal::native::motors_changed = record_port;
+
+    if (strcmp(argv[3], "tracking") == 0) record_tracking(motors, argc > 4 ? atof(argv[4]) : 600);
+    else if (strcmp(argv[3], "slew") == 0) record_slew(motors, argc > 4 ? atof(argv[4]) : 30, argc > 5 ? atof(argv[5]) : 90);
+    else {
+        fclose(output);
+        return -1;
+    }
+
+    hal::native::motors_changed = nullptr;
+
+    Dec::pulses_t dec;
+    Ra::pulses_t ra;
+    motors.get_made_pulses(dec, ra);
+    fprintf(output, "# balance %ld %ld\n", dec.value, ra.value);
+    fprintf(output, "# end %llu\n", (unsigned long long)hal::native::cycles());
+
+    fclose(output);
+    return 0;
+}
+
+// header lines and port changes of a trace file
+class TraceReader {
+
+    public:
+
+        TraceReader(FILE* file) : _file(file) {}
+
+        // returns false at the end of the file, otherwise sets either 'key' and 'args' of
+        // a header line or 'cycles' and 'port' (and clears 'key')
+        bool next(char key[16], char args[112], uint64_t& cycles, uint8_t& port) {
+            char line[128];
+            while (fgets(line, sizeof(line), _file)) {
+                unsigned long long c;
+                unsigned int p;
+                key[0] = args[0] = '\0';
+                if (line[0] == '#') {
+                    if (sscanf(line, "# %15s %111[^\n]", key, args) >= 1) return true;
+                }
+                else if (sscanf(line, "%llu %x", &c, &p) == 2) {
+                    cycles = c;
+                    port = p;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+
+        FILE* _file;
+};
+
+// analysis of pulses of a single motor
+class AxisAnalyzer {
+
+    public:
+
+        AxisAnalyzer(const char* name, uint8_t step, uint8_t dir, uint8_t ms, bool dir_swap,
+                     double microsteps_per_rev, double revs_per_deg,
+                     int accel_steps, int accel_delay, int delay_start, int delay_end) :
+            _name(name), _step(step), _dir(dir), _ms(ms), _dir_swap(dir_swap),
+            _microsteps_per_rev(microsteps_per_rev), _revs_per_deg(revs_per_deg),
+            _accel_steps(accel_steps), _accel_delay(accel_delay), _delay_start(delay_start), _delay_end(delay_end) {}
+
+        const char* name() const { return _name; }
+
+        void set_rate(double rate) { _rate = rate; }
+
+        void set_cpu_hz(double hz) { _cpu_hz = hz; }
+
+        void set_expected_balance(long balance) {
+            _expected_balance = balance;
+            _has_expected_balance = true;
+        }
+
+        void change(uint64_t cycles, uint8_t port) {
+
+            if (!_started) {
+                _port = port;
+                _started = true;
+                return;
+            }
+
+            uint8_t changed = port ^ _port;
+            _port = port;
+
+            if (changed & ((1 << _dir) | (1 << _ms))) finish();
+            if (!(changed & (1 << _step))) return;
+
+            // the same as MotorController::pulse_balance
+            _balance += (port & (1 << _ms) ? 1 : MICROSTEPPING_MUL) * (((port >> _dir) & 1) != _dir_swap ? -1 : 1);
+            if (!(port & (1 << _step))) return;
+
+            if (!_steps.empty() && cycles - _steps.back() > GAP_CYCLES) finish();
+            if (_steps.empty()) {
+                _microstepping = port & (1 << _ms);
+                _forward = ((port >> _dir) & 1) == _dir_swap;
+            }
+            _steps.push_back(cycles);
+        }
+
+        // reports the movement in progress
+        void finish() {
+            if (_steps.size() > 1) report();
+            _steps.clear();
+        }
+
+        void report_position() {
+            double revs = _balance * 0.5 / _microsteps_per_rev;
+            printf("%-3s final position: %ld pulses, %.4f motor revs, %.4f deg", _name, _balance, revs, revs / _revs_per_deg);
+            if (_has_expected_balance) printf(", %s MotorController", _balance == _expected_balance ? "matches" : "DIFFERS FROM");
+            printf("\n");
+        }
+
+    private:
+
+        double to_us(uint64_t cycles) const { return cycles * 1e6 / _cpu_hz; }
+
+        void report() {
+
+            size_t n = _steps.size();
+            double duration = to_us(_steps.back() - _steps.front());
+
+            printf("\n%-3s %s steps %s at %.3f s: %lu steps in %.3f s (%.3f steps/s)\n", _name,
+                   _microstepping ? "micro" : "full", _forward ? "forward" : "backward",
+                   to_us(_steps.front()) / 1e6, (unsigned long)n, duration / 1e6, (n - 1) * 1e6 / duration);
+
+            // intervals between steps
+            double sum = 0, sum_sq = 0, lo = 1e30, hi = 0;
+            std::map<long, unsigned long> histogram;
+            for (size_t i = 1; i < n; ++i) {
+                double interval = to_us(_steps[i] - _steps[i - 1]);
+                sum += interval;
+                sum_sq += interval * interval;
+                lo = min(lo, interval);
+                hi = max(hi, interval);
+                ++histogram[(long)(interval + 0.5)];
+            }
+            double mean = sum / (n - 1);
+            double deviation = sqrt(max(0.0, sum_sq / (n - 1) - mean * mean));
+            printf("  interval (us): min %.1f, mean %.1f, max %.1f, jitter %.1f rms, %.1f peak to peak\n", lo, mean, hi, deviation, hi - lo);
+
+            print_histogram(histogram, n - 1);
+
+            if (_microstepping && _rate != 0) report_rate();
+            if (!_microstepping) report_profile();
+        }
+
+        void print_histogram(const std::map<long, unsigned long>& histogram, size_t count) {
+
+            // the most frequent bins in the order of intervals
+            std::vector<std::pair<long, unsigned long>> bins(histogram.begin(), histogram.end());
+            while (bins.size() > HISTOGRAM_BINS) {
+                size_t least = 0;
+                for (size_t i = 1; i < bins.size(); ++i) if (bins[i].second < bins[least].second) least = i;
+                bins.erase(bins.begin() + least);
+            }
+
+            unsigned long most = 0, shown = 0;
+            for (auto& bin : bins) {
+                most = max(most, bin.second);
+                shown += bin.second;
+            }
+
+            for (auto& bin : bins) {
+                char bar[41];
+                int length = 40 * bin.second / most;
+                memset(bar, '#', length);
+                bar[length] = '\0';
+                printf("  %8ld us %9lu %s\n", bin.first, bin.second, bar);
+            }
+            if (shown < count) printf("  %8s    %9lu in %lu other bins\n", "", count - shown, (unsigned long)(histogram.size() - bins.size()));
+        }
+
+        // compares the steps with the commanded rate, the phase error is the deviation from
+        // steps of the exact rate, which is what trails stars during long exposures
+        void report_rate() {
+
+            size_t n = _steps.size();
+            double period = 1e6 / fabs(_rate);
+            double rate = (n - 1) * 1e6 / to_us(_steps.back() - _steps.front());
+
+            double sum = 0;
+            for (size_t i = 0; i < n; ++i) sum += to_us(_steps[i] - _steps[0]) - i * period;
+            double offset = sum / n, phase = 0;
+            for (size_t i = 0; i < n; ++i) phase = max(phase, fabs(to_us(_steps[i] - _steps[0]) - i * period - offset));
+
+            double arcsec = phase / period / _microsteps_per_rev / _revs_per_deg * 3600.0;
+            printf("  commanded %.6f steps/s, rate error %+.1f ppm, phase error %.1f us peak (%.2f arcsec)\n",
+                   fabs(_rate), (rate / fabs(_rate) - 1.0) * 1e6, phase, arcsec);
+        }
+
+        // compares fast steps with the ideal trapezoidal profile of config.h (the delay changes by
+        // ACCEL_DELAY_xx every ACCEL_STEPS_xx steps between FAST_DELAY_START_xx and FAST_DELAY_END_xx)
+        void report_profile() {
+
+            size_t n = _steps.size();
+            double sum_sq = 0, worst = 0;
+            unsigned long off = 0;
+
+            for (size_t i = 1; i < n; ++i) {
+                long levels = min(i, n - i) / _accel_steps;
+                double expected = max((double)_delay_end, (double)_delay_start - levels * _accel_delay);
+                double error = to_us(_steps[i] - _steps[i - 1]) - expected;
+                sum_sq += error * error;
+                worst = max(worst, fabs(error));
+                if (fabs(error) > 2 * TMR_RESOLUTION) ++off;
+            }
+
+            printf("  acceleration profile: error %.1f us rms, %.1f us max, %lu steps off by more than two ticks\n",
+                   sqrt(sum_sq / (n - 1)), worst, off);
+        }
+
+        const char* _name;
+        uint8_t _step, _dir, _ms;
+        bool _dir_swap;
+        double _microsteps_per_rev, _revs_per_deg;
+        int _accel_steps, _accel_delay, _delay_start, _delay_end;
+
+        double _cpu_hz = F_CPU;
+        double _rate = 0;
+        long _expected_balance = 0;
+        bool _has_expected_balance = false;
+
+        bool _started = false;
+        uint8_t _port = 0;
+        long _balance = 0;
+
+        bool _microstepping = false;
+        bool _forward = true;
+        std::vector<uint64_t> _steps;
+};
+
+static int analyze(int argc, char* argv[]) {
+
+    if (argc < 3) return -1;
+
+    FILE* file = fopen(argv[2], "r");
+    if (!file) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    AxisAnalyzer axes[2] = {
+        { "DEC", STEP_PIN_DEC, DIR_PIN_DEC, MS_PIN_DEC, DIRECTION_DEC, Dec::MICROSTEPS_PER_REV, Dec::REVS_PER_DEG,
+          ACCEL_STEPS_DEC, ACCEL_DELAY_DEC, FAST_DELAY_START_DEC, FAST_DELAY_END_DEC },
+        { "RA", STEP_PIN_RA, DIR_PIN_RA, MS_PIN_RA, DIRECTION_RA, Ra::MICROSTEPS_PER_REV, Ra::REVS_PER_DEG,
+          ACCEL_STEPS_RA, ACCEL_DELAY_RA, FAST_DELAY_START_RA, FAST_DELAY_END_RA }
+    };
+
+    TraceReader reader(file);
+    char key[16], args[112];
+    uint64_t cycles = 0;
+    uint8_t port = 0;
+
+    while (reader.next(key, args, cycles, port)) {
+
+        if (key[0] == '\0') {
+            for (auto& axis : axes) axis.change(cycles, port);
+            continue;
+        }
+
+        char name[16];
+        double value;
+        long dec, ra;
+
+        if (strcmp(key, "cpu_hz") == 0) {
+            for (auto& axis : axes) axis.set_cpu_hz(atof(args));
+        }
+        else if (strcmp(key, "rate") == 0 && sscanf(args, "%15s %lf", name, &value) == 2) {
+            for (auto& axis : axes) if (strcasecmp(axis.name(), name) == 0) axis.set_rate(value);
+        }
+        else if (strcmp(key, "balance") == 0 && sscanf(args, "%ld %ld", &dec, &ra) == 2) {
+            axes[0].set_expected_balance(dec);
+            axes[1].set_expected_balance(ra);
+        }
+    }
+
+    fclose(file);
+
+    for (auto& axis : axes) axis.finish();
+    printf("\n");
+    for (auto& axis : axes) axis.report_position();
+
+    return 0;
+}
+
+static int export_vcd(int argc, char* argv[]) {
+
+    if (argc < 4) return -1;
+
+    FILE* file = fopen(argv[2], "r");
+    if (!file) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    FILE* vcd = fopen(argv[3], "w");
+    if (!vcd) {
+        perror(argv[3]);
+        fclose(file);
+        return 1;
+    }
+
+    struct { const char* name; uint8_t pin; char id; } signals[] = {
+        { "dec_step", STEP_PIN_DEC, 'a' }, { "dec_dir", DIR_PIN_DEC, 'b' }, { "dec_ms", MS_PIN_DEC, 'c' },
+        { "ra_step",  STEP_PIN_RA,  'd' }, { "ra_dir",  DIR_PIN_RA,  'e' }, { "ra_ms",  MS_PIN_RA,  'f' }
+    };
+
+    fprintf(vcd, "$timescale 1 ns $end\n$scope module motors $end\n");
+    for (auto& signal : signals) fprintf(vcd, "$var wire 1 %c %s $end\n", signal.id, signal.name);
+    fprintf(vcd, "$upscope $end\n$enddefinitions $end\n");
+
+    TraceReader reader(file);
+    char key[16], args[112];
+    uint64_t cycles = 0;
+    uint8_t port = 0, last = 0;
+    double cpu_hz = F_CPU;
+    bool first = true;
+
+    while (reader.next(key, args, cycles, port)) {
+
+        if (key[0] != '\0') {
+            if (strcmp(key, "cpu_hz") == 0) cpu_hz = atof(args);
+            continue;
+        }
+
+        fprintf(vcd, "#%llu\n", (unsigned long long)(cycles * 1e9 / cpu_hz + 0.5));
+        if (first) fprintf(vcd, "$dumpvars\n");
+        for (auto& signal : signals) {
+            if (first || ((port ^ last) & (1 << signal.pin))) fprintf(vcd, "%d%c\n", (port >> signal.pin) & 1, signal.id);
+        }
+        if (first) fprintf(vcd, "$end\n");
+
+        last = port;
+        first = false;
+    }
+
+    fclose(file);
+    fclose(vcd);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+
+    int result = -1;
+    if (argc > 1 && strcmp(argv[1], "record") == 0) result = record(argc, argv);
+    else if (argc > 1 && strcmp(argv[1], "analyze") == 0) result = analyze(argc, argv);
+    else if (argc > 1 && strcmp(argv[1], "vcd") == 0) result = export_vcd(argc, argv);
+
+    if (result < 0) {
+        fprintf(stderr, "usage: %s record trace.txt tracking [seconds]\n", argv[0]);
+        fprintf(stderr, "       %s record trace.txt slew [dec_deg ra_deg]\n", argv[0]);
+        fprintf(stderr, "       %s analyze trace.txt\n", argv[0]);
+        fprintf(stderr, "       %s vcd trace.txt trace.vcd\n", argv[0]);
+        return 2;
+    }
+    return result;
+}
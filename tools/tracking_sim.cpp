@@ -0,0 +1,320 @@
+// Fast forward simulation of whole nights of tracking. The firmware (MountController with the
+// step generator of MotorController) runs on the native HAL in virtual time, thousands of times
+// faster than real time, and the position of its axes is compared with the true position of
+// the tracked object given by an exact model of the mount (double precision, the refraction
+// formula instead of its table). The RMS and peak error of each session are reported for
+// a sweep of mount types, pole misalignments and declinations, so it is the regression
+// benchmark of any change of tracking.
+//
+//   tracking_sim [hours] [single] [rates] [positions]
+//
+// Sessions are 8 hours long by default and centered at the meridian transit of the object. Each
+// of them is run in the tracking modes given (all by default) side by side: 'rates' and
+// 'positions' are TRACKING_RATES and TRACKING_POSITIONS of MountController, 'single' is the
+// former single constant rate tracking (one slow turn with the axis rates of the start, which
+// are taken from the exact model here, so the baseline does not suffer from any rounding).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "config.h"
+#include "core/mount_controller.h"
+#include "core/rtc_ds3231.h"
+
+#define SAMPLE_MS       10000   // the tracking error is sampled every 10 s of virtual time
+#define LOOP_MS         10      // the same as loop() of the sketch
+
+using Dec = MotorController::Dec;
+using Ra = MotorController::Ra;
+
+struct vector_t { double x, y, z; };
+
+static const double RAD = M_PI / 180.0;
+
+static vector_t to_vector(double dec, double ra) {
+    return { cos(dec * RAD) * cos(ra * RAD), cos(dec * RAD) * sin(ra * RAD), sin(dec * RAD) };
+}
+
+static double dot(vector_t a, vector_t b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+// angle between unit vectors in arc seconds
+static double distance(vector_t a, vector_t b) {
+    vector_t c = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    return atan2(sqrt(dot(c, c)), dot(a, b)) / RAD * 3600.0;
+}
+
+// exact counterpart of the mount model of MountController (the same matrices and conventions)
+class MountModel {
+
+    public:
+
+        MountModel(double pole_dec, double pole_ra, double ra_offset) {
+            double dec[3][3] = {{ sin(pole_dec * RAD), 0, -cos(pole_dec * RAD) }, { 0, 1, 0 }, { cos(pole_dec * RAD), 0, sin(pole_dec * RAD) }};
+            double pole[3][3], offset[3][3], product[3][3];
+            rotation(pole_ra, pole);
+            rotation(ra_offset, offset);
+            multiply(dec, pole, product);
+            multiply(offset, product, _transition);
+            _zenith = to_vector(LATITUDE, 180);
+        }
+
+        // global (time dependent, see MountController::to_time_global_ra) to local coordinates
+        vector_t to_local(vector_t global) const { return apply(refract(global, false), false); }
+
+        vector_t to_global(vector_t local) const { return refract(apply(local, true), true); }
+
+        // altitude (deg) of a point in global coordinates
+        double altitude(vector_t global) const { return asin(dot(global, _zenith)) / RAD; }
+
+    private:
+
+        static void rotation(double ra, double m[3][3]) {
+            double r[3][3] = {{ cos(ra * RAD), sin(ra * RAD), 0 }, { -sin(ra * RAD), cos(ra * RAD), 0 }, { 0, 0, 1 }};
+            for (int i = 0; i < 3; ++i) for (int j = 0; j < 3; ++j) m[i][j] = r[i][j];
+        }
+
+        static void multiply(double a[3][3], double b[3][3], double c[3][3]) {
+            for (int i = 0; i < 3; ++i) for (int j = 0; j < 3; ++j) {
+                c[i][j] = 0;
+                for (int k = 0; k < 3; ++k) c[i][j] += a[i][k] * b[k][j];
+            }
+        }
+
+        // the transition is a rotation, so its inverse is the transposition
+        vector_t apply(vector_t v, bool inverse) const {
+            double m[3][3];
+            for (int i = 0; i < 3; ++i) for (int j = 0; j < 3; ++j) m[i][j] = inverse ? _transition[j][i] : _transition[i][j];
+            return { m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+                     m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+                     m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z };
+        }
+
+        // Saemundsson's formula (deg) for the true altitude (deg), see core/refraction.h
+        static double refraction(double altitude) {
+            return 1.02 / tan((altitude + 10.3 / (altitude + 5.11)) * RAD) / 60.0 *
+                   REFRACTION_PRESSURE / 1010.0 * 283.0 / (273.0 + REFRACTION_TEMPERATURE);
+        }
+
+        // rotates the point towards the zenith (true to apparent) or back if 'inverse'
+        vector_t refract(vector_t p, bool inverse) const {
+
+            if (REFRACTION_PRESSURE <= 0) return p;
+
+            // the point is cos(altitude) * horizontal + sin(altitude) * zenith
+            double s = dot(p, _zenith);
+            vector_t horizontal = { p.x - s * _zenith.x, p.y - s * _zenith.y, p.z - s * _zenith.z };
+            double length = sqrt(dot(horizontal, horizontal));
+            if (length < 1e-8) return p;
+
+            double altitude = atan2(s, length) / RAD;
+            double refracted = altitude + refraction(altitude);
+            if (inverse) {
+                // the true altitude h solves h + refraction(h) = altitude
+                refracted = altitude - refraction(altitude);
+                for (int i = 0; i < 8; ++i) refracted = altitude - refraction(refracted);
+            }
+
+            double c = cos(refracted * RAD) / length, z = sin(refracted * RAD);
+            return { c * horizontal.x + z * _zenith.x, c * horizontal.y + z * _zenith.y, c * horizontal.z + z * _zenith.z };
+        }
+
+        double _transition[3][3];
+        vector_t _zenith;
+};
+
+struct session_t {
+    const char* mount;
+    double pole_dec, pole_ra;
+    double dec;
+};
+
+// tracking modes of the comparison, TRACKING_RATES and TRACKING_POSITIONS are those of config.h
+#define TRACKING_SINGLE_RATE    2
+
+static const struct { const char* name; uint8_t mode; } modes[] = {
+    { "single", TRACKING_SINGLE_RATE },
+    { "rates", TRACKING_RATES },
+    { "positions", TRACKING_POSITIONS },
+};
+
+struct result_t {
+    double rms, peak, final;
+    double tracked_hours;
+    bool below_horizon;
+};
+
+static RtcDS3231 rtc;
+static MountController mount(MotorController::instance());
+
+// direction of the mount axes in local coordinates given by the balance of motor pulses
+static vector_t axes_direction() {
+    Dec::pulses_t dec;
+    Ra::pulses_t ra;
+    MotorController::instance().get_made_pulses(dec, ra);
+    return to_vector(Dec::pulses_to_revs(dec) / (double)Dec::REVS_PER_DEG, Ra::pulses_to_revs(ra) / (double)Ra::REVS_PER_DEG);
+}
+
+static double seconds() { return hal::native::cycles() / (double)F_CPU; }
+
+// DEC and RA (deg) of the axes of a direction in local coordinates which is the nearest to the
+// axes at 'dec' and 'ra' (the direction can be reached over the pole of the mount as well)
+static void nearest_axes(vector_t local, double& dec, double& ra) {
+
+    double target_dec = asin(local.z) / RAD;
+    double target_ra = atan2(local.y, local.x) / RAD;
+    double best = 1e9;
+    double best_dec = dec, best_ra = ra;
+
+    for (int flipped = 0; flipped < 2; ++flipped) {
+        double d = flipped ? (target_dec >= 0 ? 180 : -180) - target_dec : target_dec;
+        double r = ra + remainder(target_ra + (flipped ? 180 : 0) - ra, 360.0);
+        double distance = fabs(d - dec) + fabs(r - ra);
+        if (distance < best) {
+            best = distance;
+            best_dec = d;
+            best_ra = r;
+        }
+    }
+
+    dec = best_dec;
+    ra = best_ra;
+}
+
+// the single rate tracking, both axes turn at constant rates taken at the start for 'hours'
+static void start_single_rate(const MountModel& model, double target_dec, double target_ra, double lst, double hours) {
+
+    const double dt = 60;
+
+    Dec::pulses_t dec_pulses;
+    Ra::pulses_t ra_pulses;
+    MotorController::instance().get_made_pulses(dec_pulses, ra_pulses);
+    double dec = Dec::pulses_to_revs(dec_pulses) / (double)Dec::REVS_PER_DEG;
+    double ra = Ra::pulses_to_revs(ra_pulses) / (double)Ra::REVS_PER_DEG;
+
+    double dec_start = dec, ra_start = ra;
+    nearest_axes(model.to_local(to_vector(target_dec, 180.0 - target_ra + lst)), dec_start, ra_start);
+    double dec_end = dec_start, ra_end = ra_start;
+    nearest_axes(model.to_local(to_vector(target_dec, 180.0 - target_ra + lst + dt * 360.0 / 86164.0905)), dec_end, ra_end);
+
+    double seconds = hours * 3600.0;
+    float revs_dec = Dec::deg_to_revs((dec_end - dec_start) / dt * seconds);
+    float revs_ra = Ra::deg_to_revs((ra_end - ra_start) / dt * seconds);
+    MotorController::instance().slow_turn(revs_dec, revs_ra, fabs(revs_dec) / seconds, fabs(revs_ra) / seconds, false);
+}
+
+static bool simulate(const session_t& session, double hours, uint8_t mode, result_t& result) {
+
+    rtc.sync(DateTime(2026, 10, 18, 20, 0, 0));
+    mount.initialize();
+    // RA offset of the mount puts the transit of the object to local RA 180, far from RA limits
+    vector_t transit = MountModel(session.pole_dec, session.pole_ra, 0).to_local(to_vector(session.dec, 180));
+    double ra_offset = atan2(transit.y, transit.x) / RAD - 180.0;
+
+    mount.set_mount_pole({ (float)session.pole_dec, (float)session.pole_ra }, ra_offset);
+    MountModel model(session.pole_dec, session.pole_ra, ra_offset);
+
+    // the object transits the meridian in the middle of the session
+    double ra = fmod(Clock::get_decimal_LST() * 15.0 + hours * 7.5 + 360.0, 360.0);
+    if (!mount.move_absolute(session.dec, ra)) return false;
+    while (mount.is_moving()) hal::native::advance_micros(LOOP_MS * 1000UL);
+
+    // the target is where the mount points at when the tracking starts
+    double start = seconds();
+    double lst = Clock::get_decimal_LST() * 15.0;
+    vector_t global = model.to_global(axes_direction());
+    double target_ra = 180.0 - atan2(global.y, global.x) / RAD + lst;
+    double target_dec = asin(global.z) / RAD;
+
+    if (mode == TRACKING_SINGLE_RATE) {
+        start_single_rate(model, target_dec, target_ra, lst, hours);
+    } else {
+        mount.set_tracking_mode(mode);
+        mount.set_tracking();
+    }
+
+    double sum_sq = 0, error = 0;
+    unsigned long samples = 0;
+    unsigned long next_sample = millis();
+
+    result = result_t { 0, 0, 0, 0, false };
+
+    while (seconds() - start < hours * 3600.0 && (mode == TRACKING_SINGLE_RATE || mount.is_tracking())) {
+
+        mount.update();
+        hal::native::advance_micros(LOOP_MS * 1000UL);
+
+        if ((long)(millis() - next_sample) < 0) continue;
+        next_sample += SAMPLE_MS;
+
+        double now = lst + (seconds() - start) * 360.0 / 86164.0905;
+        vector_t sky = to_vector(target_dec, 180.0 - target_ra + now);
+        result.below_horizon |= model.altitude(sky) < 0;
+
+        error = distance(model.to_local(sky), axes_direction());
+        result.peak = max(result.peak, error);
+        sum_sq += error * error;
+        ++samples;
+    }
+
+    result.tracked_hours = (seconds() - start) / 3600.0;
+    result.rms = samples ? sqrt(sum_sq / samples) : 0;
+    result.final = error;
+    mount.stop_all();
+
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+
+    double hours = argc > 1 ? atof(argv[1]) : 8;
+    if (hours <= 0) {
+        fprintf(stderr, "usage: %s [hours] [single] [rates] [positions]\n", argv[0]);
+        return 2;
+    }
+
+    bool selected[3];
+    for (int m = 0; m < 3; ++m) {
+        selected[m] = argc <= 2;
+        for (int i = 2; i < argc; ++i) selected[m] |= strcmp(argv[i], modes[m].name) == 0;
+    }
+
+    const double misalignments[] = { 0, 0.5, 2 };
+    const double declinations[] = { 0, 30, 60, 85 };
+
+    printf("%.1f hour sessions centered at the meridian, latitude %.2f, errors in arc seconds\n\n", hours, LATITUDE);
+    printf("%-12s %8s %6s", "", "", "");
+    for (int m = 0; m < 3; ++m) if (selected[m]) printf(" %-27s", modes[m].name);
+    printf("\n%-12s %8s %6s", "mount", "pole off", "DEC");
+    for (int m = 0; m < 3; ++m) if (selected[m]) printf(" %8s %8s %8s  ", "RMS", "peak", "final");
+    printf("\n");
+
+    for (int type = 0; type < 2; ++type) {
+        for (double misalignment : misalignments) {
+            for (double dec : declinations) {
+
+                session_t session = type == 0 ?
+                    session_t { "equatorial", 90 - misalignment, 0, dec } :
+                    session_t { "altazimuth", LATITUDE - misalignment, 180, dec };
+
+                printf("%-12s %8.1f %6.0f", session.mount, misalignment, dec);
+                for (int m = 0; m < 3; ++m) {
+                    if (!selected[m]) continue;
+                    result_t result;
+                    if (!simulate(session, hours, modes[m].mode, result)) {
+                        printf(" %26s ", "refused");
+                        continue;
+                    }
+                    // the tracking stopped early (S) or the object set below the horizon (H)
+                    printf(" %8.1f %8.1f %8.1f %c", result.rms, result.peak, result.final,
+                           result.tracked_hours < hours - 0.01 ? 'S' : result.below_horizon ? 'H' : ' ');
+                }
+                printf("\n");
+                fflush(stdout);
+            }
+        }
+    }
+
+    return 0;
+}